@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Tareq Mhisen
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+
+"""Report the nRF52833 RAM sections kept powered by power_down_unused_ram().
+
+power_down_unused_ram() switches off every RAM section located entirely
+above _image_ram_end. This script reads the linked ELF, lists the sections
+that stay powered, the objects that occupy the last powered section and
+the expected retention current. It fails if more sections stay powered
+than allowed by --max-sections, 0 only reports.
+"""
+
+import argparse
+import sys
+
+from elftools.elf.elffile import ELFFile
+from elftools.elf.sections import SymbolTableSection
+
+RAM_BASE = 0x20000000
+
+# nRF52833: RAM0..RAM7 hold two 4 KB sections each, RAM8 two 32 KB sections
+RAM_SECTIONS = (
+    [(f"RAM{i // 2}.S{i % 2}", 4 * 1024) for i in range(16)]
+    + [("RAM8.S0", 32 * 1024), ("RAM8.S1", 32 * 1024)]
+)
+
+# Approximate System ON retention current per KB of powered RAM, derived
+# from the RAM retention figures of the nRF52 product specifications.
+DEFAULT_NA_PER_KB = 8.0
+
+
+def ram_sections():
+    start = RAM_BASE
+    for name, size in RAM_SECTIONS:
+        yield name, start, size
+        start += size
+
+
+def read_symbols(elf):
+    symtab = elf.get_section_by_name(".symtab")
+    if not isinstance(symtab, SymbolTableSection):
+        sys.exit("error: ELF file has no symbol table")
+
+    markers = {}
+    objects = []
+    for sym in symtab.iter_symbols():
+        if sym.name in ("_image_ram_start", "_image_ram_end"):
+            markers[sym.name] = sym["st_value"]
+        elif sym["st_info"]["type"] == "STT_OBJECT" and sym["st_size"] > 0:
+            objects.append((sym["st_value"], sym["st_size"], sym.name))
+
+    for name in ("_image_ram_start", "_image_ram_end"):
+        if name not in markers:
+            sys.exit(f"error: symbol {name} not found")
+
+    return markers["_image_ram_start"], markers["_image_ram_end"], objects
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--elf", required=True, help="linked zephyr.elf")
+    parser.add_argument("--output", help="write the report to this file as well")
+    parser.add_argument("--max-sections", type=int, required=True,
+                        help="fail if more RAM sections stay powered, 0 only reports")
+    parser.add_argument("--na-per-kb", type=float, default=DEFAULT_NA_PER_KB,
+                        help="retention current per KB of powered RAM in nA")
+    parser.add_argument("--top", type=int, default=10,
+                        help="number of objects listed for the last powered section")
+    args = parser.parse_args()
+
+    with open(args.elf, "rb") as f:
+        ram_start, ram_end, objects = read_symbols(ELFFile(f))
+
+    lines = []
+    powered = []
+    powered_kb = 0
+    total_kb = 0
+    for name, start, size in ram_sections():
+        total_kb += size // 1024
+        if start < ram_end:
+            used = min(ram_end, start + size) - start
+            powered.append((name, start, size))
+            powered_kb += size // 1024
+            lines.append(f"  {name:8} 0x{start:08x} {size // 1024:3} KB  powered, "
+                         f"{used * 100 // size:3}% used")
+        else:
+            lines.append(f"  {name:8} 0x{start:08x} {size // 1024:3} KB  off")
+
+    last_name, last_start, last_size = powered[-1]
+    in_last = sorted((o for o in objects if last_start <= o[0] < last_start + last_size),
+                     key=lambda o: o[1], reverse=True)
+
+    saved_na = (total_kb - powered_kb) * args.na_per_kb
+    header = [
+        f"RAM used: 0x{ram_start:08x} - 0x{ram_end:08x} ({(ram_end - ram_start) / 1024:.1f} KB)",
+        f"Powered RAM sections: {len(powered)} of {len(RAM_SECTIONS)} "
+        f"({powered_kb} of {total_kb} KB)",
+        f"Estimated retention current: {powered_kb * args.na_per_kb:.0f} nA "
+        f"({saved_na:.0f} nA saved by power_down_unused_ram())",
+    ]
+    footer = [f"Largest objects in {last_name}:"]
+    footer += [f"  0x{addr:08x} {size:6} B  {name}" for addr, size, name in in_last[:args.top]]
+
+    report = "\n".join(header + lines + footer)
+    print(report)
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(report + "\n")
+
+    if args.max_sections == 0:
+        print(f"warning: no RAM section budget, set CONFIG_RAM_POWERED_SECTIONS_MAX={len(powered)} "
+              "to fail builds that power more sections")
+    elif len(powered) > args.max_sections:
+        sys.exit(f"error: {len(powered)} RAM sections stay powered, "
+                 f"CONFIG_RAM_POWERED_SECTIONS_MAX allows {args.max_sections}")
+
+
+if __name__ == "__main__":
+    main()
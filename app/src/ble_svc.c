@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/gap.h>
+#include <zephyr/sys/atomic.h>
+
+#include <ram_pwrdn.h>
+
+#include "ble_svc.h"
+#include "bthome.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(ble_svc, LOG_LEVEL_DBG);
+
+#define HEARTBEAT_PERIOD_MSEC (1000 * CONFIG_BTHOME_HEARTBEAT_PERIOD_SECONDS)
+#define SEC_PER_DAY           (24ULL * 60 * 60)
+
+/* Preamble, access address, PDU header, AdvA and CRC of a legacy advertising PDU */
+#define ADV_PDU_OVERHEAD_BYTES 16
+#define ADV_BYTE_TIME_US       8
+/* Radio ramp-up and channel switch overhead per advertising channel */
+#define ADV_RAMP_UP_US         140
+#define ADV_CHANNELS           3
+
+enum burst_flag {
+	/* Advertising started, the controller has not reported the events yet */
+	BURST_ACTIVE,
+	/* New data waits for the end of the active burst */
+	BURST_PENDING,
+	BURST_FLAG_COUNT,
+};
+
+static uint8_t service_data[BTHOME_SERVICE_DATA_LEN];
+
+static const struct bt_data ad[] = {
+	BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
+	BT_DATA(BT_DATA_SVC_DATA16, service_data, sizeof(service_data)),
+};
+
+static struct bt_le_ext_adv *adv;
+static struct ble_svc_stats stats;
+static uint32_t adv_event_radio_on_us;
+static int64_t last_burst_ms;
+static bool advertised;
+static int16_t last_temperature;
+static uint16_t last_humidity;
+static ATOMIC_DEFINE(burst_flags, BURST_FLAG_COUNT);
+static struct k_work burst_work;
+
+static void adv_sent(struct bt_le_ext_adv *instance, struct bt_le_ext_adv_sent_info *info)
+{
+	uint64_t uptime_s = k_uptime_get() / MSEC_PER_SEC;
+
+	ARG_UNUSED(instance);
+
+	stats.adv_events += info->num_sent;
+	stats.radio_on_us += info->num_sent * adv_event_radio_on_us;
+
+	atomic_clear_bit(burst_flags, BURST_ACTIVE);
+	if (atomic_test_bit(burst_flags, BURST_PENDING)) {
+		k_work_submit(&burst_work);
+	}
+
+	if (uptime_s == 0) {
+		return;
+	}
+
+	/* Extrapolate the counters since boot to a full day */
+	LOG_DBG("Advertising: %llu events/day, %llu ms/day radio on (est.)",
+		stats.adv_events * SEC_PER_DAY / uptime_s,
+		stats.radio_on_us * SEC_PER_DAY / uptime_s / USEC_PER_MSEC);
+}
+
+static const struct bt_le_ext_adv_cb adv_callbacks = {
+	.sent = adv_sent,
+};
+
+static void burst_work_handler(struct k_work *work)
+{
+	int ret;
+
+	ARG_UNUSED(work);
+
+	if (!atomic_test_and_clear_bit(burst_flags, BURST_PENDING)) {
+		return;
+	}
+
+	ret = bt_le_ext_adv_set_data(adv, ad, ARRAY_SIZE(ad), NULL, 0);
+	if (ret != 0) {
+		LOG_ERR("Failed to set advertising data: %d", ret);
+		return;
+	}
+
+	atomic_set_bit(burst_flags, BURST_ACTIVE);
+	ret = bt_le_ext_adv_start(adv, BT_LE_EXT_ADV_START_PARAM(0, CONFIG_BTHOME_ADV_EVENTS));
+	if (ret != 0) {
+		atomic_clear_bit(burst_flags, BURST_ACTIVE);
+		LOG_ERR("Failed to start advertising: %d", ret);
+		return;
+	}
+
+	stats.bursts++;
+}
+
+static int ble_svc_start_burst(void)
+{
+	last_burst_ms = k_uptime_get();
+	advertised = true;
+
+	/*
+	 * A running burst is not stopped, the controller would not report the events it sent.
+	 * The new data goes out in a full burst once the running one is done.
+	 */
+	atomic_set_bit(burst_flags, BURST_PENDING);
+	if (atomic_test_bit(burst_flags, BURST_ACTIVE)) {
+		return 0;
+	}
+
+	return MIN(k_work_submit(&burst_work), 0);
+}
+
+int ble_svc_update_measurements(int16_t temperature, uint16_t humidity)
+{
+	bool changed = !advertised ||
+		       abs(temperature - last_temperature) >= CONFIG_BTHOME_TEMPERATURE_DELTA ||
+		       abs(humidity - last_humidity) >= CONFIG_BTHOME_HUMIDITY_DELTA;
+	bool heartbeat_due = (k_uptime_get() - last_burst_ms) >= HEARTBEAT_PERIOD_MSEC;
+
+	if (!changed && !heartbeat_due) {
+		stats.skipped++;
+		return 0;
+	}
+
+	last_temperature = temperature;
+	last_humidity = humidity;
+	(void)bthome_encode(service_data, sizeof(service_data), temperature, humidity);
+
+	return ble_svc_start_burst();
+}
+
+int ble_svc_advertise_now(void)
+{
+	return ble_svc_start_burst();
+}
+
+void ble_svc_get_stats(struct ble_svc_stats *out)
+{
+	*out = stats;
+}
+
+int ble_svc_init(void)
+{
+	int ret;
+	size_t adv_data_len = 0;
+
+	(void)bthome_encode(service_data, sizeof(service_data), 0, 0);
+	k_work_init(&burst_work, burst_work_handler);
+
+	ret = bt_enable(NULL);
+	if (ret != 0) {
+		LOG_ERR("Bluetooth init failed: %d", ret);
+		return ret;
+	}
+
+	/* Non-connectable, non-scannable legacy advertising from the static identity address */
+	ret = bt_le_ext_adv_create(BT_LE_ADV_PARAM(BT_LE_ADV_OPT_USE_IDENTITY,
+						   BT_GAP_ADV_FAST_INT_MIN_2,
+						   BT_GAP_ADV_FAST_INT_MAX_2, NULL),
+				   &adv_callbacks, &adv);
+	if (ret != 0) {
+		LOG_ERR("Failed to create advertising set: %d", ret);
+		return ret;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(ad); i++) {
+		/* Length and type octets of each AD structure */
+		adv_data_len += 2 + ad[i].data_len;
+	}
+
+	adv_event_radio_on_us =
+		ADV_CHANNELS * (ADV_RAMP_UP_US +
+				(ADV_PDU_OVERHEAD_BYTES + adv_data_len) * ADV_BYTE_TIME_US);
+
+	if (IS_ENABLED(CONFIG_RAM_POWER_DOWN_LIBRARY)) {
+		power_down_unused_ram();
+	}
+
+	LOG_INF("BTHome broadcaster ready, %zu bytes of advertising data, ~%u us radio on/event",
+		adv_data_len, adv_event_radio_on_us);
+
+	return 0;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_BLE_SVC_H
+#define APP_BLE_SVC_H
+
+#include <stdint.h>
+
+/* BTHome v2 temperature object: sint16, factor 0.01 degrees Celsius */
+#define BTHOME_TEMPERATURE_MULTIPLIER 100
+/* BTHome v2 humidity object: uint16, factor 0.01 % */
+#define BTHOME_HUMIDITY_MULTIPLIER    100
+
+struct ble_svc_stats {
+	/* Advertising bursts started (value change, heartbeat or button) */
+	uint32_t bursts;
+	/* Measurements not advertised because neither the values changed nor a heartbeat was due */
+	uint32_t skipped;
+	/* Advertising events completed by the controller */
+	uint32_t adv_events;
+	/* Estimated radio on time of all advertising events */
+	uint32_t radio_on_us;
+};
+
+/**
+ * @brief Update the measurements and advertise them if they changed or a heartbeat is due.
+ *
+ * @param[in] temperature Temperature in 0.01 degrees Celsius.
+ * @param[in] humidity Relative humidity in 0.01 %.
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+int ble_svc_update_measurements(int16_t temperature, uint16_t humidity);
+
+/**
+ * @brief Advertise the last measurements immediately, or right after a burst in progress.
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+int ble_svc_advertise_now(void);
+
+/**
+ * @brief Get the advertising counters.
+ *
+ * @param[out] stats Counters since boot.
+ */
+void ble_svc_get_stats(struct ble_svc_stats *stats);
+
+/**
+ * @brief Enable Bluetooth and create the advertising set.
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+int ble_svc_init(void);
+
+#endif /* APP_BLE_SVC_H */
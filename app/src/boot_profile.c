@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+
+#include "boot_profile.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(boot_profile, LOG_LEVEL_INF);
+
+static const char *const milestone_names[] = {
+	[BOOT_MILESTONE_KERNEL] = "kernel",
+	[BOOT_MILESTONE_MAIN] = "main",
+	[BOOT_MILESTONE_POWER_INIT] = "power_init",
+	[BOOT_MILESTONE_SENSOR_INIT] = "sensor_init",
+	[BOOT_MILESTONE_ZB_CTX_REGISTERED] = "zb_ctx_registered",
+	[BOOT_MILESTONE_ZB_CLUSTERS_INIT] = "zb_clusters_init",
+	[BOOT_MILESTONE_RAM_POWER_DOWN] = "ram_power_down",
+	[BOOT_MILESTONE_ZB_ENABLED] = "zigbee_enable",
+	[BOOT_MILESTONE_UI_INIT] = "ui_init",
+	[BOOT_MILESTONE_MAIN_DONE] = "main_done",
+	[BOOT_MILESTONE_FIRST_RX] = "first_rx",
+	[BOOT_MILESTONE_FIRST_REPORT_QUEUED] = "first_report_queued",
+};
+BUILD_ASSERT(ARRAY_SIZE(milestone_names) == BOOT_MILESTONE_COUNT);
+
+/* 64-bit, a 32-bit microsecond count wraps after 71 minutes without a network */
+static uint64_t milestone_us[BOOT_MILESTONE_COUNT];
+
+void boot_profile_mark(enum boot_milestone milestone)
+{
+	uint64_t now_us;
+
+	if (milestone >= BOOT_MILESTONE_COUNT || milestone_us[milestone] != 0) {
+		return;
+	}
+
+	/* 0 marks a milestone not reached yet */
+	now_us = MAX(k_ticks_to_us_floor64(k_uptime_ticks()), 1);
+	milestone_us[milestone] = now_us;
+
+	if (milestone == BOOT_MILESTONE_FIRST_REPORT_QUEUED) {
+		boot_profile_dump();
+	}
+}
+
+uint64_t boot_profile_get_us(enum boot_milestone milestone)
+{
+	if (milestone >= BOOT_MILESTONE_COUNT) {
+		return 0;
+	}
+
+	return milestone_us[milestone];
+}
+
+void boot_profile_dump(void)
+{
+	uint64_t prev_us = 0;
+
+	for (size_t i = 0; i < BOOT_MILESTONE_COUNT; i++) {
+		if (milestone_us[i] == 0) {
+			continue;
+		}
+
+		LOG_INF("boot,%s,%llu,%llu", milestone_names[i], milestone_us[i],
+			milestone_us[i] - prev_us);
+		prev_us = milestone_us[i];
+	}
+}
+
+static int boot_profile_kernel_ready(void)
+{
+	boot_profile_mark(BOOT_MILESTONE_KERNEL);
+
+	return 0;
+}
+SYS_INIT(boot_profile_kernel_ready, POST_KERNEL, 0);
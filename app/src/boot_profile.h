@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_BOOT_PROFILE_H_
+#define APP_BOOT_PROFILE_H_
+
+#include <stdint.h>
+
+#include <zephyr/toolchain.h>
+
+enum boot_milestone {
+	/* Kernel services available, recorded by a POST_KERNEL init hook */
+	BOOT_MILESTONE_KERNEL,
+	BOOT_MILESTONE_MAIN,
+	BOOT_MILESTONE_POWER_INIT,
+	BOOT_MILESTONE_SENSOR_INIT,
+	BOOT_MILESTONE_ZB_CTX_REGISTERED,
+	BOOT_MILESTONE_ZB_CLUSTERS_INIT,
+	BOOT_MILESTONE_RAM_POWER_DOWN,
+	BOOT_MILESTONE_ZB_ENABLED,
+	/* Deferred until the radio stack has been started */
+	BOOT_MILESTONE_UI_INIT,
+	BOOT_MILESTONE_MAIN_DONE,
+	/* First APS data frame received, not necessarily the answer to a data poll */
+	BOOT_MILESTONE_FIRST_RX,
+	/* First report handed to the radio stack, queued rather than acknowledged */
+	BOOT_MILESTONE_FIRST_REPORT_QUEUED,
+	BOOT_MILESTONE_COUNT,
+};
+
+#if defined(CONFIG_BOOT_PROFILE)
+/**
+ * @brief Record the time of a boot milestone.
+ *
+ * @details Only the first occurrence of a milestone after reset is kept. The timeline is logged
+ *          once the first report is queued.
+ *
+ * @param milestone Milestone reached.
+ */
+void boot_profile_mark(enum boot_milestone milestone);
+
+/**
+ * @brief Get the time of a boot milestone.
+ *
+ * @param milestone Milestone.
+ *
+ * @return Microseconds since the system clock started, 0 if the milestone was not reached yet.
+ */
+uint64_t boot_profile_get_us(enum boot_milestone milestone);
+
+/**
+ * @brief Log the boot timeline, one line per milestone reached.
+ */
+void boot_profile_dump(void);
+#else
+static inline void boot_profile_mark(enum boot_milestone milestone)
+{
+	ARG_UNUSED(milestone);
+}
+#endif
+
+#endif /* APP_BOOT_PROFILE_H_ */
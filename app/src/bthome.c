@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+
+#include <zephyr/sys/byteorder.h>
+
+#include "bthome.h"
+
+int bthome_encode(uint8_t *buf, size_t size, int16_t temperature, uint16_t humidity)
+{
+	if (size < BTHOME_SERVICE_DATA_LEN) {
+		return -ENOBUFS;
+	}
+
+	/* Objects are sorted by ID as the BTHome v2 format requires */
+	sys_put_le16(BTHOME_SERVICE_UUID, &buf[0]);
+	buf[2] = BTHOME_DEVICE_INFO;
+	buf[3] = BTHOME_OBJ_TEMPERATURE;
+	sys_put_le16((uint16_t)temperature, &buf[4]);
+	buf[6] = BTHOME_OBJ_HUMIDITY;
+	sys_put_le16(humidity, &buf[7]);
+
+	return BTHOME_SERVICE_DATA_LEN;
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_BTHOME_H
+#define APP_BTHOME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BTHOME_SERVICE_UUID    0xFCD2
+/* BTHome v2, unencrypted, advertised on change rather than at a regular interval */
+#define BTHOME_DEVICE_INFO     0x44
+#define BTHOME_OBJ_TEMPERATURE 0x02
+#define BTHOME_OBJ_HUMIDITY    0x03
+
+/* Service UUID, device information and the temperature and humidity objects */
+#define BTHOME_SERVICE_DATA_LEN 9
+
+/**
+ * @brief Encode the measurements as BTHome v2 service data.
+ *
+ * @param[out] buf Buffer receiving the service data, starting with the 16-bit service UUID.
+ * @param[in] size Size of the buffer.
+ * @param[in] temperature Temperature in 0.01 degrees Celsius.
+ * @param[in] humidity Relative humidity in 0.01 %.
+ *
+ * @return Number of bytes written, -ENOBUFS if the buffer is too small.
+ */
+int bthome_encode(uint8_t *buf, size_t size, int16_t temperature, uint16_t humidity);
+
+#endif /* APP_BTHOME_H */
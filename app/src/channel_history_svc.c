@@ -0,0 +1,315 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+
+#include <nrf_802154.h>
+#include <zboss_api.h>
+
+#include "channel_history_svc.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(channel_history_svc, LOG_LEVEL_DBG);
+
+#define CHANNEL_HISTORY_SETTINGS_KEY "chan_hist"
+#define CHANNEL_HISTORY_ENTRIES_KEY  "entries"
+#define CHANNEL_HISTORY_BEACONS_KEY  "beacons"
+
+/* First byte of a received frame is the PHY length, the MAC frame control follows */
+#define MAC_FRAME_CONTROL_OFFSET 1
+#define MAC_FRAME_TYPE_MASK      0x07
+#define MAC_FRAME_TYPE_BEACON    0x00
+
+struct channel_history_entry {
+	/* 0 marks an unused slot */
+	uint8_t channel;
+	uint16_t pan_id;
+};
+
+/* Ordered by most recent successful join first */
+static struct channel_history_entry history[CONFIG_CHANNEL_HISTORY_SIZE];
+/* Channels where beacons were received during the last scan that heard any */
+static uint32_t beacon_channels;
+/* Filled from the radio interrupt while a scan runs */
+static atomic_t beacons_heard;
+
+static struct channel_scan_stats stats;
+static uint32_t scan_start_ms;
+static bool scan_in_progress;
+static uint32_t primary_mask;
+static uint32_t secondary_mask;
+
+static int channel_history_settings_set(const char *name, size_t len, settings_read_cb read_cb,
+					void *cb_arg)
+{
+	ssize_t ret;
+
+	if (settings_name_steq(name, CHANNEL_HISTORY_BEACONS_KEY, NULL)) {
+		if (len != sizeof(beacon_channels)) {
+			return 0;
+		}
+
+		ret = read_cb(cb_arg, &beacon_channels, sizeof(beacon_channels));
+		if (ret < 0) {
+			LOG_ERR("Failed to read beacon channels: %d", ret);
+			beacon_channels = 0;
+			return ret;
+		}
+
+		return 0;
+	}
+
+	if (!settings_name_steq(name, CHANNEL_HISTORY_ENTRIES_KEY, NULL)) {
+		return -ENOENT;
+	}
+
+	/* Ignore a history stored with a different CONFIG_CHANNEL_HISTORY_SIZE */
+	if (len != sizeof(history)) {
+		LOG_WRN("Discarding channel history of unexpected size %zu", len);
+		return 0;
+	}
+
+	ret = read_cb(cb_arg, history, sizeof(history));
+	if (ret < 0) {
+		LOG_ERR("Failed to read channel history: %d", ret);
+		memset(history, 0, sizeof(history));
+		return ret;
+	}
+
+	return 0;
+}
+SETTINGS_STATIC_HANDLER_DEFINE(channel_history, CHANNEL_HISTORY_SETTINGS_KEY, NULL,
+			       channel_history_settings_set, NULL, NULL);
+
+static void channel_history_save(void)
+{
+	int ret = settings_save_one(CHANNEL_HISTORY_SETTINGS_KEY "/" CHANNEL_HISTORY_ENTRIES_KEY,
+				    history, sizeof(history));
+	if (ret != 0) {
+		LOG_ERR("Failed to save channel history: %d", ret);
+	}
+}
+
+static void beacon_channels_save(void)
+{
+	int ret = settings_save_one(CHANNEL_HISTORY_SETTINGS_KEY "/" CHANNEL_HISTORY_BEACONS_KEY,
+				    &beacon_channels, sizeof(beacon_channels));
+	if (ret != 0) {
+		LOG_ERR("Failed to save beacon channels: %d", ret);
+	}
+}
+
+/* Called by the radio driver from its interrupt for every received frame, --wrap forwards
+ * it to the Zigbee stack, which owns the buffer from then on.
+ */
+void __real_nrf_802154_received_timestamp_raw(uint8_t *data, int8_t power, uint8_t lqi,
+					      uint64_t time);
+
+void __wrap_nrf_802154_received_timestamp_raw(uint8_t *data, int8_t power, uint8_t lqi,
+					      uint64_t time)
+{
+	/* Beacons only arrive as answers to the beacon requests of a scan */
+	if (data[0] > MAC_FRAME_CONTROL_OFFSET &&
+	    (data[MAC_FRAME_CONTROL_OFFSET] & MAC_FRAME_TYPE_MASK) == MAC_FRAME_TYPE_BEACON) {
+		atomic_or(&beacons_heard, BIT(nrf_802154_channel_get()));
+	}
+
+	__real_nrf_802154_received_timestamp_raw(data, power, lqi, time);
+}
+
+/* Keep the channels heard in this scan, a scan that heard nothing keeps the previous ones */
+static bool beacon_channels_update(void)
+{
+	uint32_t heard = (uint32_t)atomic_clear(&beacons_heard) & CONFIG_ZIGBEE_CHANNEL_MASK;
+
+	if (heard == 0 || heard == beacon_channels) {
+		return false;
+	}
+
+	LOG_DBG("Beacons heard on channels 0x%08x", heard);
+	beacon_channels = heard;
+	beacon_channels_save();
+
+	return true;
+}
+
+static uint32_t channel_history_known_mask(void)
+{
+	uint32_t mask = beacon_channels;
+
+	for (size_t i = 0; i < ARRAY_SIZE(history); i++) {
+		if (history[i].channel != 0) {
+			mask |= BIT(history[i].channel);
+		}
+	}
+
+	return mask & CONFIG_ZIGBEE_CHANNEL_MASK;
+}
+
+static bool channel_history_insert(uint8_t channel, uint16_t pan_id)
+{
+	size_t pos;
+
+	for (pos = 0; pos < ARRAY_SIZE(history) - 1; pos++) {
+		if (history[pos].channel == channel && history[pos].pan_id == pan_id) {
+			break;
+		}
+	}
+
+	if (pos == 0 && history[0].channel == channel && history[0].pan_id == pan_id) {
+		/* Already the most recent entry, nothing to persist */
+		return false;
+	}
+
+	/* Shift newer entries down, dropping the oldest one if the channel is new */
+	memmove(&history[1], &history[0], pos * sizeof(history[0]));
+	history[0].channel = channel;
+	history[0].pan_id = pan_id;
+
+	return true;
+}
+
+void channel_history_svc_apply_scan_mask(void)
+{
+	uint32_t known_mask = channel_history_known_mask();
+
+	if (known_mask == 0) {
+		primary_mask = CONFIG_ZIGBEE_CHANNEL_MASK;
+		secondary_mask = 0;
+	} else {
+		primary_mask = known_mask;
+		secondary_mask = CONFIG_ZIGBEE_CHANNEL_MASK & ~known_mask;
+	}
+
+	zb_set_bdb_primary_channel_set(primary_mask);
+	zb_set_bdb_secondary_channel_set(secondary_mask);
+
+	LOG_DBG("Scan channel sets: primary 0x%08x, secondary 0x%08x", primary_mask,
+		secondary_mask);
+}
+
+void channel_history_svc_scan_started(void)
+{
+	scan_start_ms = k_uptime_get_32();
+	scan_in_progress = true;
+	atomic_clear(&beacons_heard);
+}
+
+void channel_history_svc_scan_finished(bool joined)
+{
+	uint8_t channel = 0;
+	uint32_t visited;
+	uint32_t duration;
+	bool changed;
+
+	if (!scan_in_progress) {
+		return;
+	}
+
+	duration = k_uptime_get_32() - scan_start_ms;
+
+	if (joined) {
+		channel = zb_get_current_channel();
+	}
+
+	/* BDB scans the secondary set only if nothing was found on the primary set */
+	visited = popcount(primary_mask);
+	if (!joined || !(BIT(channel) & primary_mask)) {
+		visited += popcount(secondary_mask);
+	}
+
+	stats.scans++;
+	stats.last_duration_ms = duration;
+	stats.total_duration_ms += duration;
+	stats.last_channels_visited = visited;
+	stats.total_channels_visited += visited;
+
+	if (!joined) {
+		stats.scans_failed++;
+		LOG_INF("Scan failed after %u ms, %u channels visited", duration, visited);
+
+		/* The stack keeps retrying until ZB_DEV_REJOIN_TIMEOUT_MS expires, the next
+		 * attempt starts with the channels where networks answered.
+		 */
+		if (beacon_channels_update()) {
+			channel_history_svc_apply_scan_mask();
+		}
+		scan_start_ms = k_uptime_get_32();
+		return;
+	}
+
+	scan_in_progress = false;
+
+	LOG_INF("Network found on channel %u after %u ms, %u channels visited (avg %u ms)",
+		channel, duration, visited, stats.total_duration_ms / stats.scans);
+
+	/* Both run, so a changed beacon set is saved even if the network is already known */
+	changed = beacon_channels_update();
+	if (channel_history_insert(channel, zb_get_pan_id())) {
+		channel_history_save();
+		changed = true;
+	}
+
+	if (changed) {
+		channel_history_svc_apply_scan_mask();
+	}
+}
+
+void channel_history_svc_get_stats(struct channel_scan_stats *out)
+{
+	*out = stats;
+}
+
+void channel_history_svc_clear(void)
+{
+	int ret;
+
+	memset(history, 0, sizeof(history));
+	beacon_channels = 0;
+
+	ret = settings_delete(CHANNEL_HISTORY_SETTINGS_KEY "/" CHANNEL_HISTORY_ENTRIES_KEY);
+	if (ret != 0) {
+		LOG_ERR("Failed to delete channel history: %d", ret);
+	}
+
+	ret = settings_delete(CHANNEL_HISTORY_SETTINGS_KEY "/" CHANNEL_HISTORY_BEACONS_KEY);
+	if (ret != 0) {
+		LOG_ERR("Failed to delete beacon channels: %d", ret);
+	}
+}
+
+int channel_history_svc_init(void)
+{
+	int ret;
+
+	ret = settings_subsys_init();
+	if (ret != 0) {
+		LOG_ERR("Failed to initialize settings: %d", ret);
+		return ret;
+	}
+
+	ret = settings_load_subtree(CHANNEL_HISTORY_SETTINGS_KEY);
+	if (ret != 0) {
+		LOG_ERR("Failed to load channel history: %d", ret);
+		return ret;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(history) && history[i].channel != 0; i++) {
+		LOG_DBG("Known network %zu: channel %u, PAN ID 0x%04x", i, history[i].channel,
+			history[i].pan_id);
+	}
+	LOG_DBG("Beacons last heard on channels 0x%08x", beacon_channels);
+
+	channel_history_svc_apply_scan_mask();
+
+	return 0;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_CHANNEL_HISTORY_SVC_H_
+#define APP_CHANNEL_HISTORY_SVC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct channel_scan_stats {
+	uint32_t scans;
+	uint32_t scans_failed;
+	uint32_t last_duration_ms;
+	uint32_t total_duration_ms;
+	uint32_t last_channels_visited;
+	uint32_t total_channels_visited;
+};
+
+/**
+ * @brief Restore the persisted channel history and apply it to the scan channel sets.
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+int channel_history_svc_init(void);
+
+/**
+ * @brief Configure the BDB channel sets from the channel history.
+ *
+ * @details The channels of joined networks and the channels where beacons were heard
+ *          become the primary channel set, all remaining channels of CONFIG_ZIGBEE_CHANNEL_MASK
+ *          the secondary set. The stack scans the
+ *          secondary set only if no network was found on the primary set.
+ */
+void channel_history_svc_apply_scan_mask(void);
+
+/**
+ * @brief Mark the start of a network steering or rejoin scan.
+ */
+void channel_history_svc_scan_started(void);
+
+/**
+ * @brief Mark the end of a network steering or rejoin scan.
+ *
+ * @details The channels where beacons were heard during the scan are persisted, whether a
+ *          network was joined or not.
+ *
+ * @param joined true if the device is in a network, the current channel and PAN ID are then
+ *               moved to the front of the history.
+ */
+void channel_history_svc_scan_finished(bool joined);
+
+/**
+ * @brief Get the scan duration and visited channels counters.
+ *
+ * @param[out] stats Counters since boot.
+ */
+void channel_history_svc_get_stats(struct channel_scan_stats *stats);
+
+/**
+ * @brief Forget all known channels (used on a factory reset requested by the user).
+ */
+void channel_history_svc_clear(void);
+
+#endif /* APP_CHANNEL_HISTORY_SVC_H_ */
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/device.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log_ctrl.h>
+#include <zephyr/pm/device_runtime.h>
+#include <zephyr/spinlock.h>
+
+#include "device_pm_svc.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(device_pm_svc, LOG_LEVEL_DBG);
+
+#define LOG_FLUSH_PERIOD K_MSEC(CONFIG_LOG_UART_FLUSH_PERIOD_MS)
+
+struct device_pm_entry {
+	const struct device *dev;
+	struct device_pm_stats stats;
+	uint32_t usage;
+	int64_t resumed_at_ms;
+};
+
+static struct device_pm_entry entries[CONFIG_DEVICE_RUNTIME_PM_MAX_DEVICES];
+static struct k_spinlock lock;
+
+/* Must be called with the lock held */
+static struct device_pm_entry *device_pm_entry_get(const struct device *dev, bool add)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(entries); i++) {
+		if (entries[i].dev == dev) {
+			return &entries[i];
+		}
+		if (entries[i].dev == NULL && add) {
+			entries[i].dev = dev;
+			return &entries[i];
+		}
+	}
+
+	return NULL;
+}
+
+int device_pm_svc_get(const struct device *dev)
+{
+	struct device_pm_entry *entry;
+	k_spinlock_key_t key;
+	int ret;
+
+	ret = pm_device_runtime_get(dev);
+	if (ret != 0) {
+		LOG_ERR("Failed to resume %s: %d", dev->name, ret);
+		return ret;
+	}
+
+	key = k_spin_lock(&lock);
+	entry = device_pm_entry_get(dev, true);
+	if (entry != NULL && entry->usage++ == 0) {
+		entry->stats.resumes++;
+		entry->resumed_at_ms = k_uptime_get();
+	}
+	k_spin_unlock(&lock, key);
+
+	return 0;
+}
+
+int device_pm_svc_put(const struct device *dev)
+{
+	struct device_pm_entry *entry;
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&lock);
+	entry = device_pm_entry_get(dev, false);
+	if (entry != NULL && entry->usage > 0 && --entry->usage == 0) {
+		entry->stats.suspends++;
+		entry->stats.active_ms += (uint32_t)(k_uptime_get() - entry->resumed_at_ms);
+	}
+	k_spin_unlock(&lock, key);
+
+	return pm_device_runtime_put(dev);
+}
+
+int device_pm_svc_get_stats(const struct device *dev, struct device_pm_stats *stats)
+{
+	struct device_pm_entry *entry;
+	k_spinlock_key_t key;
+	int ret = 0;
+
+	key = k_spin_lock(&lock);
+	entry = device_pm_entry_get(dev, false);
+	if (entry == NULL) {
+		ret = -ENOENT;
+	} else {
+		*stats = entry->stats;
+		if (entry->usage > 0) {
+			stats->active_ms += (uint32_t)(k_uptime_get() - entry->resumed_at_ms);
+		}
+	}
+	k_spin_unlock(&lock, key);
+
+	return ret;
+}
+
+void device_pm_svc_log_stats(void)
+{
+	struct device_pm_stats stats;
+	uint32_t uptime_ms = k_uptime_get_32();
+
+	for (size_t i = 0; i < ARRAY_SIZE(entries) && entries[i].dev != NULL; i++) {
+		if (device_pm_svc_get_stats(entries[i].dev, &stats) != 0) {
+			continue;
+		}
+
+		LOG_INF("%s: %u resumes, %u suspends, active %u ms of %u ms", entries[i].dev->name,
+			stats.resumes, stats.suspends, stats.active_ms, uptime_ms);
+	}
+}
+
+#if defined(CONFIG_LOG_UART_ON_DEMAND)
+static const struct device *const console_dev = DEVICE_DT_GET(DT_CHOSEN(zephyr_console));
+
+static void log_flush_work_handler(struct k_work *_work)
+{
+	struct k_work_delayable *work = k_work_delayable_from_work(_work);
+
+	/* Keep the UART suspended when there is nothing to print */
+	if (log_data_pending()) {
+		if (device_pm_svc_get(console_dev) == 0) {
+			while (log_process()) {
+			}
+			(void)device_pm_svc_put(console_dev);
+		}
+	}
+
+	k_work_reschedule(work, LOG_FLUSH_PERIOD);
+}
+static K_WORK_DELAYABLE_DEFINE(log_flush_work, log_flush_work_handler);
+#endif
+
+int device_pm_svc_init(void)
+{
+#if defined(CONFIG_LOG_UART_ON_DEMAND)
+	int ret;
+
+	if (!device_is_ready(console_dev)) {
+		return -ENODEV;
+	}
+
+	/* The console stays active until here so early boot messages are not lost */
+	ret = pm_device_runtime_enable(console_dev);
+	if (ret != 0) {
+		LOG_ERR("Failed to enable runtime PM for %s: %d", console_dev->name, ret);
+		return ret;
+	}
+
+	/* The log core started the backends at boot, without the log thread only the flush work
+	 * processes the messages
+	 */
+	k_work_reschedule(&log_flush_work, K_NO_WAIT);
+#endif
+
+	return 0;
+}
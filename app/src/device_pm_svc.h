@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_DEVICE_PM_SVC_H_
+#define APP_DEVICE_PM_SVC_H_
+
+#include <stdint.h>
+
+#include <zephyr/device.h>
+
+struct device_pm_stats {
+	uint32_t resumes;
+	uint32_t suspends;
+	/* Time spent resumed since boot */
+	uint32_t active_ms;
+};
+
+/**
+ * @brief Resume a device before using it.
+ *
+ * @details Calls are reference counted, the device is only resumed by the first one. Devices
+ *          without runtime PM support are tracked but not touched.
+ *
+ * @param dev Device to resume.
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+int device_pm_svc_get(const struct device *dev);
+
+/**
+ * @brief Release a device resumed with device_pm_svc_get().
+ *
+ * @details The device is suspended once the last user released it.
+ *
+ * @param dev Device to release.
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+int device_pm_svc_put(const struct device *dev);
+
+/**
+ * @brief Get the resume and suspend counters of a device.
+ *
+ * @param dev Device.
+ * @param[out] stats Counters since boot, active time includes the current active period.
+ *
+ * @return 0 on success, -ENOENT if the device was never resumed through this service.
+ */
+int device_pm_svc_get_stats(const struct device *dev, struct device_pm_stats *stats);
+
+/**
+ * @brief Log the counters of all tracked devices.
+ */
+void device_pm_svc_log_stats(void);
+
+/**
+ * @brief Suspend the console UART and start the on-demand log flush (CONFIG_LOG_UART_ON_DEMAND).
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+int device_pm_svc_init(void);
+
+#endif /* APP_DEVICE_PM_SVC_H_ */
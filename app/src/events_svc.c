@@ -13,6 +13,35 @@ LOG_MODULE_REGISTER(events_svc);
 
 K_MSGQ_DEFINE(event_msq, sizeof(struct event), EVENT_QUEUE_SIZE, 4);
 
+static events_svc_handler_t event_handler;
+static struct events_svc_stats stats;
+
+static void event_work_handler(struct k_work *work)
+{
+	struct event evt;
+	uint32_t latency_us;
+
+	if (event_handler == NULL) {
+		return;
+	}
+
+	/* Drain the queue, several events may have been sent before the work item ran */
+	while (k_msgq_get(&event_msq, &evt, K_NO_WAIT) == 0) {
+		latency_us = k_cyc_to_us_floor32(k_cycle_get_32() - evt.sent_cyc);
+
+		stats.dispatched++;
+		stats.last_latency_us = latency_us;
+		stats.total_latency_us += latency_us;
+		stats.max_latency_us = MAX(stats.max_latency_us, latency_us);
+
+		LOG_DBG("%s dispatched after %u us (max %u us)", events_svc_type_to_text(evt.type),
+			latency_us, stats.max_latency_us);
+
+		event_handler(&evt);
+	}
+}
+K_WORK_DEFINE(event_work, event_work_handler);
+
 char *events_svc_type_to_text(enum event_type type)
 {
 	switch (type) {
@@ -27,12 +56,43 @@ char *events_svc_type_to_text(enum event_type type)
 	}
 }
 
+void events_svc_register_handler(events_svc_handler_t handler)
+{
+	event_handler = handler;
+	k_work_submit(&event_work);
+}
+
 int events_svc_send_event(struct event *evt)
 {
-	return k_msgq_put(&event_msq, evt, K_NO_WAIT);
+	int ret;
+
+	evt->sent_cyc = k_cycle_get_32();
+
+	ret = k_msgq_put(&event_msq, evt, K_NO_WAIT);
+	if (ret != 0) {
+		stats.dropped++;
+		return ret;
+	}
+
+	k_work_submit(&event_work);
+
+	return 0;
 }
 
-int events_svc_get_event(struct event *evt)
+void events_svc_get_stats(struct events_svc_stats *out)
 {
-	return k_msgq_get(&event_msq, evt, K_FOREVER);
-}
\ No newline at end of file
+	*out = stats;
+}
+
+void events_svc_log_stats(void)
+{
+	struct events_svc_stats s = stats;
+	uint32_t avg_latency_us = 0;
+
+	if (s.dispatched > 0) {
+		avg_latency_us = (uint32_t)(s.total_latency_us / s.dispatched);
+	}
+
+	LOG_INF("Events: %u dispatched, %u dropped, latency last %u us, avg %u us, max %u us",
+		s.dispatched, s.dropped, s.last_latency_us, avg_latency_us, s.max_latency_us);
+}
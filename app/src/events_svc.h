@@ -7,7 +7,10 @@
 #ifndef APP_EVENT_MANAGER_H_
 #define APP_EVENT_MANAGER_H_
 
-#define EVENT_QUEUE_SIZE 10
+#include <stdint.h>
+
+/* Events are rare and drained right away, 5 entries of 8 B keep the queue at 40 B */
+#define EVENT_QUEUE_SIZE 5
 
 enum event_type {
 	EVENT_NETWORK_CONNECTED,
@@ -17,6 +20,21 @@ enum event_type {
 
 struct event {
 	enum event_type type;
+	/* Set by events_svc_send_event, used to measure the dispatch latency */
+	uint32_t sent_cyc;
+};
+
+/**
+ * @brief Event handler, called from the system workqueue for every queued event
+ */
+typedef void (*events_svc_handler_t)(const struct event *evt);
+
+struct events_svc_stats {
+	uint32_t dispatched;
+	uint32_t dropped;
+	uint32_t last_latency_us;
+	uint32_t max_latency_us;
+	uint64_t total_latency_us;
 };
 
 /**
@@ -28,7 +46,17 @@ struct event {
 char *events_svc_type_to_text(enum event_type type);
 
 /**
- * @brief Pushes an event to the message queue
+ * @brief Register the handler that events are dispatched to
+ *
+ * @param handler function called from the system workqueue, events queued before a handler is
+ *                registered are dispatched once it is.
+ */
+void events_svc_register_handler(events_svc_handler_t handler);
+
+/**
+ * @brief Pushes an event to the message queue and schedules its dispatch
+ *
+ * @details Safe to call from any thread, the event is handled on the system workqueue.
  *
  * @param evt pointer to the event to be sent.
  * @return int
@@ -36,11 +64,15 @@ char *events_svc_type_to_text(enum event_type type);
 int events_svc_send_event(struct event *evt);
 
 /**
- * @brief Gets an event from the message queue
+ * @brief Get the dispatch counters and the send-to-handler latency
  *
- * @param evt pointer to the event to be received.
- * @return int
+ * @param[out] stats counters since boot.
+ */
+void events_svc_get_stats(struct events_svc_stats *stats);
+
+/**
+ * @brief Log the dispatch counters and the measured send-to-handler latency
  */
-int events_svc_get_event(struct event *evt);
+void events_svc_log_stats(void);
 
 #endif /* APP_EVENT_MANAGER_H_ */
\ No newline at end of file
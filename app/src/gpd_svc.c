@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/hwinfo.h>
+#include <zephyr/random/random.h>
+#include <zephyr/sys/byteorder.h>
+
+#include <nrf_802154.h>
+#include <ram_pwrdn.h>
+
+#include "gpd_svc.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(gpd_svc, LOG_LEVEL_DBG);
+
+/* MAC data frame, short broadcast destination, no source address, no ack request */
+#define MAC_FCF_GPDF        0x0801
+#define MAC_BROADCAST       0xFFFF
+/* GP NWK frame control: data frame, protocol version 3, ApplicationID 0 (SrcID) */
+#define GP_NWK_FC_DATA      0x0C
+
+/* Green Power command identifiers */
+#define GP_CMD_MULTI_CLUSTER_REPORT 0xA1
+#define GP_CMD_COMMISSIONING        0xE0
+#define GP_CMD_DECOMMISSIONING      0xE1
+
+/* Green Power device ID: Indoor Environment Sensor */
+#define GP_DEVICE_ID_INDOOR_ENVIRONMENT 0x33
+/* Commissioning options: random sequence numbers, no RxOnCapability, no security */
+#define GP_COMMISSIONING_OPTIONS        0x00
+
+#define ZCL_CLUSTER_ID_TEMP_MEASUREMENT         0x0402
+#define ZCL_CLUSTER_ID_REL_HUMIDITY_MEASUREMENT 0x0405
+#define ZCL_ATTR_MEASURED_VALUE_ID              0x0000
+#define ZCL_ATTR_TYPE_S16                       0x29
+#define ZCL_ATTR_TYPE_U16                       0x21
+
+/* SrcID values reserved by the Green Power specification */
+#define GP_SRC_ID_UNSPECIFIED    0x00000000
+#define GP_SRC_ID_RESERVED_START 0xFFFFFFF8
+
+#define PHR_LEN        1
+#define FCS_LEN        2
+#define SHR_LEN        5
+#define MAX_PSDU_LEN   127
+#define BYTE_TIME_US   32
+/* Radio ramp-up, CCA and RX to TX turnaround before every transmission */
+#define TX_OVERHEAD_US 360
+#define TX_TIMEOUT_MS  20
+
+static uint8_t frame[PHR_LEN + MAX_PSDU_LEN];
+static uint32_t src_id;
+static uint8_t mac_seq_num;
+static struct gpd_svc_stats stats;
+
+/* Later radio driver versions return an nrf_802154_tx_error_t, 0 on success */
+BUILD_ASSERT(__builtin_types_compatible_p(__typeof__(nrf_802154_transmit_raw(NULL, NULL)), bool),
+	     "nrf_802154_transmit_raw() no longer returns bool, update the result check");
+
+static K_MUTEX_DEFINE(tx_lock);
+static K_SEM_DEFINE(tx_done, 0, 1);
+static volatile bool tx_ok;
+
+/* Radio driver callouts, called from the radio IRQ */
+void nrf_802154_transmitted_raw(uint8_t *p_frame,
+				const nrf_802154_transmit_done_metadata_t *p_metadata)
+{
+	ARG_UNUSED(p_frame);
+	ARG_UNUSED(p_metadata);
+
+	tx_ok = true;
+	k_sem_give(&tx_done);
+}
+
+void nrf_802154_transmit_failed(uint8_t *p_frame, nrf_802154_tx_error_t error,
+				const nrf_802154_transmit_done_metadata_t *p_metadata)
+{
+	ARG_UNUSED(p_frame);
+	ARG_UNUSED(error);
+	ARG_UNUSED(p_metadata);
+
+	tx_ok = false;
+	k_sem_give(&tx_done);
+}
+
+static size_t gpdf_put_header(uint8_t *psdu)
+{
+	size_t len = 0;
+
+	sys_put_le16(MAC_FCF_GPDF, &psdu[len]);
+	len += sizeof(uint16_t);
+	psdu[len++] = mac_seq_num++;
+	/* Destination PAN ID and address */
+	sys_put_le16(MAC_BROADCAST, &psdu[len]);
+	len += sizeof(uint16_t);
+	sys_put_le16(MAC_BROADCAST, &psdu[len]);
+	len += sizeof(uint16_t);
+
+	psdu[len++] = GP_NWK_FC_DATA;
+	sys_put_le32(src_id, &psdu[len]);
+	len += sizeof(uint32_t);
+
+	return len;
+}
+
+static int gpd_svc_send(uint8_t cmd_id, const uint8_t *payload, size_t payload_len)
+{
+	const nrf_802154_transmit_metadata_t metadata = {
+		.frame_props = NRF_802154_TRANSMITTED_FRAME_PROPS_DEFAULT_INIT,
+		.cca = true,
+	};
+	uint8_t *psdu = &frame[PHR_LEN];
+	uint32_t on_air_bytes;
+	int transmitted = 0;
+	size_t len;
+	int ret = 0;
+
+	k_mutex_lock(&tx_lock, K_FOREVER);
+
+	len = gpdf_put_header(psdu);
+	psdu[len++] = cmd_id;
+	memcpy(&psdu[len], payload, payload_len);
+	len += payload_len;
+
+	/* The radio appends the FCS */
+	frame[0] = len + FCS_LEN;
+	on_air_bytes = SHR_LEN + PHR_LEN + len + FCS_LEN;
+
+	nrf_802154_channel_set(CONFIG_GPD_CHANNEL);
+
+	for (int i = 0; i < CONFIG_GPD_TX_REPEATS; i++) {
+		k_sem_reset(&tx_done);
+
+		/* True once the driver accepted the frame, as in nRF Connect SDK v2.8 */
+		if (!nrf_802154_transmit_raw(frame, &metadata)) {
+			ret = -EBUSY;
+			break;
+		}
+
+		if (k_sem_take(&tx_done, K_MSEC(TX_TIMEOUT_MS)) != 0) {
+			ret = -ETIMEDOUT;
+			break;
+		}
+
+		stats.radio_on_us += TX_OVERHEAD_US;
+		if (!tx_ok) {
+			stats.tx_failed++;
+			continue;
+		}
+
+		stats.bytes_on_air += on_air_bytes;
+		stats.radio_on_us += on_air_bytes * BYTE_TIME_US;
+		transmitted++;
+	}
+
+	/* Nothing is ever received, the radio only wakes up to transmit */
+	(void)nrf_802154_sleep();
+
+	if (ret == 0 && transmitted == 0) {
+		ret = -EIO;
+	}
+
+	/* Only frames the driver reported as transmitted on every repeat */
+	if (transmitted == CONFIG_GPD_TX_REPEATS) {
+		stats.frames++;
+	}
+
+	k_mutex_unlock(&tx_lock);
+
+	if (ret != 0) {
+		LOG_ERR("Failed to send GPDF 0x%02x: %d", cmd_id, ret);
+	}
+
+	return ret;
+}
+
+int gpd_svc_send_measurements(int16_t temperature, uint16_t humidity)
+{
+	uint8_t payload[14];
+	size_t len = 0;
+
+	sys_put_le16(ZCL_CLUSTER_ID_TEMP_MEASUREMENT, &payload[len]);
+	len += sizeof(uint16_t);
+	sys_put_le16(ZCL_ATTR_MEASURED_VALUE_ID, &payload[len]);
+	len += sizeof(uint16_t);
+	payload[len++] = ZCL_ATTR_TYPE_S16;
+	sys_put_le16(temperature, &payload[len]);
+	len += sizeof(uint16_t);
+
+	sys_put_le16(ZCL_CLUSTER_ID_REL_HUMIDITY_MEASUREMENT, &payload[len]);
+	len += sizeof(uint16_t);
+	sys_put_le16(ZCL_ATTR_MEASURED_VALUE_ID, &payload[len]);
+	len += sizeof(uint16_t);
+	payload[len++] = ZCL_ATTR_TYPE_U16;
+	sys_put_le16(humidity, &payload[len]);
+	len += sizeof(uint16_t);
+
+	return gpd_svc_send(GP_CMD_MULTI_CLUSTER_REPORT, payload, len);
+}
+
+int gpd_svc_commission(void)
+{
+	const uint8_t payload[] = {GP_DEVICE_ID_INDOOR_ENVIRONMENT, GP_COMMISSIONING_OPTIONS};
+
+	LOG_INF("Sending commissioning frame on channel %d, SrcID 0x%08x", CONFIG_GPD_CHANNEL,
+		src_id);
+
+	return gpd_svc_send(GP_CMD_COMMISSIONING, payload, sizeof(payload));
+}
+
+int gpd_svc_decommission(void)
+{
+	LOG_INF("Sending decommissioning frame");
+
+	return gpd_svc_send(GP_CMD_DECOMMISSIONING, NULL, 0);
+}
+
+void gpd_svc_get_stats(struct gpd_svc_stats *out)
+{
+	*out = stats;
+}
+
+int gpd_svc_init(void)
+{
+	uint8_t device_id[8] = {0};
+	ssize_t len;
+
+	len = hwinfo_get_device_id(device_id, sizeof(device_id));
+	if (len < 0) {
+		LOG_ERR("Failed to read device ID: %d", len);
+		return len;
+	}
+
+	/* Fold the 64-bit device ID into the 32-bit SrcID */
+	src_id = sys_get_le32(&device_id[0]) ^ sys_get_le32(&device_id[4]);
+	if (src_id == GP_SRC_ID_UNSPECIFIED || src_id >= GP_SRC_ID_RESERVED_START) {
+		src_id ^= BIT(31);
+	}
+
+	mac_seq_num = (uint8_t)sys_rand32_get();
+
+	nrf_802154_init();
+	(void)nrf_802154_sleep();
+
+	if (IS_ENABLED(CONFIG_RAM_POWER_DOWN_LIBRARY)) {
+		power_down_unused_ram();
+	}
+
+	LOG_INF("Green Power Device ready, SrcID 0x%08x, channel %d", src_id, CONFIG_GPD_CHANNEL);
+
+	return 0;
+}
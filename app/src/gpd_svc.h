@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_GPD_SVC_H
+#define APP_GPD_SVC_H
+
+#include <stdint.h>
+
+/* ZCL Temperature Measurement MeasuredValue: int16, 0.01 degrees Celsius */
+#define GPD_TEMPERATURE_MULTIPLIER 100
+/* ZCL Relative Humidity Measurement MeasuredValue: uint16, 0.01 % */
+#define GPD_HUMIDITY_MULTIPLIER    100
+
+struct gpd_svc_stats {
+	/* Green Power data frames the radio transmitted all CONFIG_GPD_TX_REPEATS times */
+	uint32_t frames;
+	/* Transmissions the radio driver reported as failed (CCA busy) */
+	uint32_t tx_failed;
+	/* Bytes on air including preamble, PHY header and FCS */
+	uint32_t bytes_on_air;
+	/* Estimated radio on time of all transmissions */
+	uint32_t radio_on_us;
+};
+
+/**
+ * @brief Send a multi-cluster report with the temperature and humidity.
+ *
+ * @param[in] temperature Temperature in 0.01 degrees Celsius.
+ * @param[in] humidity Relative humidity in 0.01 %.
+ *
+ * @return 0 if at least one repeat was transmitted, negative error code otherwise.
+ */
+int gpd_svc_send_measurements(int16_t temperature, uint16_t humidity);
+
+/**
+ * @brief Send a commissioning frame, the sink must be in commissioning mode.
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+int gpd_svc_commission(void);
+
+/**
+ * @brief Send a decommissioning frame so that the sink removes this device.
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+int gpd_svc_decommission(void);
+
+/**
+ * @brief Get the transmission counters.
+ *
+ * @param[out] stats Counters since boot.
+ */
+void gpd_svc_get_stats(struct gpd_svc_stats *stats);
+
+/**
+ * @brief Initialize the radio driver and derive the GPD SrcID from the device ID.
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+int gpd_svc_init(void);
+
+#endif /* APP_GPD_SVC_H */
@@ -4,60 +4,162 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <errno.h>
+
 #include <zephyr/device.h>
 #include <zephyr/kernel.h>
+#include <zephyr/spinlock.h>
 
-#include "zb_environmental_sensor.h"
-
+#include "device_pm_svc.h"
 #include "humidity_temperature_svc.h"
 
 #include <zephyr/logging/log.h>
 
 LOG_MODULE_REGISTER(humidity_temperature_svc, LOG_LEVEL_DBG);
 
+#define MEASURING_PERIOD_MSEC (1000 * CONFIG_MEASURING_PERIOD_SECONDS)
+
 static const struct device *const rh_temp_dev = DEVICE_DT_GET_ONE(sensirion_sht4x);
+static const struct device *const rh_temp_bus = DEVICE_DT_GET(DT_BUS(DT_INST(0, sensirion_sht4x)));
 
-struct humidity_temperature_data {
-	struct sensor_value humidity;
-	struct sensor_value temperature;
-};
+/* Samples are fetched from the system workqueue and, for on-demand reads, the ZBOSS thread */
+static K_MUTEX_DEFINE(sensor_lock);
+static uint32_t sample_count;
+static uint32_t skipped_periods;
 
-static struct humidity_temperature_data data;
+/* Read without the sensor lock, so a reader never waits for a conversion */
+static struct k_spinlock sample_time_lock;
+static int64_t last_sample_ms = -1;
 
-int humidity_temperature_svc_trigger_measurement(void)
+/* Must be called with the sensor lock held */
+static void count_sample(void)
+{
+	int64_t now_ms = k_uptime_get();
+	k_spinlock_key_t key;
+	int64_t gap_ms;
+
+	key = k_spin_lock(&sample_time_lock);
+	gap_ms = now_ms - last_sample_ms;
+
+	/* A gap of N periods means N - 1 samples were not taken */
+	if (last_sample_ms >= 0 && gap_ms >= 2 * MEASURING_PERIOD_MSEC) {
+		skipped_periods += gap_ms / MEASURING_PERIOD_MSEC - 1;
+	}
+
+	last_sample_ms = now_ms;
+	k_spin_unlock(&sample_time_lock, key);
+
+	sample_count++;
+}
+
+/* Must be called with the sensor lock held */
+static int fetch(void)
 {
 	int ret;
 
+	if (IS_ENABLED(CONFIG_DEVICE_RUNTIME_PM)) {
+		/* The bus and sensor are suspended between samples */
+		ret = device_pm_svc_get(rh_temp_bus);
+		if (ret != 0) {
+			return ret;
+		}
+		ret = device_pm_svc_get(rh_temp_dev);
+		if (ret != 0) {
+			(void)device_pm_svc_put(rh_temp_bus);
+			return ret;
+		}
+	}
+
 	ret = sensor_sample_fetch(rh_temp_dev);
-	if (ret != 0) {
-		return ret;
+	if (ret == 0) {
+		count_sample();
 	}
 
-	return 0;
+	if (IS_ENABLED(CONFIG_DEVICE_RUNTIME_PM)) {
+		(void)device_pm_svc_put(rh_temp_dev);
+		(void)device_pm_svc_put(rh_temp_bus);
+	}
+
+	return ret;
+}
+
+static int measure(k_timeout_t timeout)
+{
+	int ret;
+
+	/* Taken first, so a caller that cannot wait does not resume the bus for nothing */
+	if (k_mutex_lock(&sensor_lock, timeout) != 0) {
+		return -EBUSY;
+	}
+
+	ret = fetch();
+	k_mutex_unlock(&sensor_lock);
+
+	return ret;
+}
+
+int humidity_temperature_svc_trigger_measurement(void)
+{
+	return measure(K_FOREVER);
+}
+
+int humidity_temperature_svc_try_measurement(void)
+{
+	return measure(K_NO_WAIT);
 }
 
 float humidity_temperature_svc_get_temperature(void)
 {
-	int ret = sensor_channel_get(rh_temp_dev, SENSOR_CHAN_AMBIENT_TEMP, &data.temperature);
+	struct sensor_value temperature;
+	int ret;
+
+	k_mutex_lock(&sensor_lock, K_FOREVER);
+	ret = sensor_channel_get(rh_temp_dev, SENSOR_CHAN_AMBIENT_TEMP, &temperature);
+	k_mutex_unlock(&sensor_lock);
 	if (ret) {
 		LOG_ERR("Failed to get sensor channel: %d", ret);
 		return ret;
 	}
 
-	LOG_DBG("Temperature: %3d.%06d [°C]", data.temperature.val1, data.temperature.val2);
-	return sensor_value_to_float(&data.temperature);
+	LOG_DBG("Temperature: %3d.%06d [°C]", temperature.val1, temperature.val2);
+	return sensor_value_to_float(&temperature);
 }
 
 float humidity_temperature_svc_get_humidity(void)
 {
-	int ret = sensor_channel_get(rh_temp_dev, SENSOR_CHAN_HUMIDITY, &data.humidity);
+	struct sensor_value humidity;
+	int ret;
+
+	k_mutex_lock(&sensor_lock, K_FOREVER);
+	ret = sensor_channel_get(rh_temp_dev, SENSOR_CHAN_HUMIDITY, &humidity);
+	k_mutex_unlock(&sensor_lock);
 	if (ret) {
 		LOG_ERR("Failed to get sensor channel: %d", ret);
 		return ret;
 	}
 
-	LOG_DBG("Humidity: %3d.%06d [%%]", data.humidity.val1, data.humidity.val2);
-	return sensor_value_to_float(&data.humidity);
+	LOG_DBG("Humidity: %3d.%06d [%%]", humidity.val1, humidity.val2);
+	return sensor_value_to_float(&humidity);
+}
+
+uint32_t humidity_temperature_svc_get_sample_age_ms(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&sample_time_lock);
+	int64_t age_ms = (last_sample_ms < 0) ? UINT32_MAX : k_uptime_get() - last_sample_ms;
+
+	k_spin_unlock(&sample_time_lock, key);
+
+	return (uint32_t)MIN(age_ms, UINT32_MAX);
+}
+
+uint32_t humidity_temperature_svc_get_sample_count(void)
+{
+	return sample_count;
+}
+
+uint32_t humidity_temperature_svc_get_skipped_periods(void)
+{
+	return skipped_periods;
 }
 
 int humidity_temperature_svc_init(void)
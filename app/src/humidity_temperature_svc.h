@@ -23,6 +23,17 @@
  */
 int humidity_temperature_svc_trigger_measurement(void);
 
+/**
+ * @brief Trigger a new measurement unless one is already in progress.
+ *
+ * @details Does not wait for a measurement started by another thread. Otherwise blocks for one
+ *          conversion, at most 8.3 ms on the SHT4x at high repeatability plus the I2C transfer.
+ *
+ * @return 0 on success, -EBUSY if a measurement is in progress, or a negative error code if the
+ *         measurement fails.
+ */
+int humidity_temperature_svc_try_measurement(void);
+
 /**
  * @brief Get humidity value.
  *
@@ -37,6 +48,32 @@ float humidity_temperature_svc_get_humidity(void);
  */
 float humidity_temperature_svc_get_temperature(void);
 
+/**
+ * @brief Get the time since the last successful measurement.
+ *
+ * @details Does not wait for a measurement in progress, it counts once it completes.
+ *
+ * @return Age of the values returned by the getters in ms, UINT32_MAX if nothing was measured yet.
+ */
+uint32_t humidity_temperature_svc_get_sample_age_ms(void);
+
+/**
+ * @brief Get the number of successful measurements since boot.
+ *
+ * @return Measurement count.
+ */
+uint32_t humidity_temperature_svc_get_sample_count(void);
+
+/**
+ * @brief Get the number of sampling periods that passed without a measurement.
+ *
+ * @details Counted at each measurement from the time since the previous one, against a sample
+ *          every CONFIG_MEASURING_PERIOD_SECONDS.
+ *
+ * @return Skipped periods since the first measurement.
+ */
+uint32_t humidity_temperature_svc_get_skipped_periods(void);
+
 /**
  * @brief Initialize the humidity and temperature sensor.
  *
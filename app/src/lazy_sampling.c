@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "humidity_temperature_svc.h"
+#include "lazy_sampling.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(lazy_sampling, LOG_LEVEL_DBG);
+
+#define MAX_AGE_MSEC (1000 * CONFIG_LAZY_SAMPLING_MAX_AGE_SECONDS)
+
+/* ZCL frame control: frame type and manufacturer-specific bits */
+#define ZCL_FRAME_TYPE_MASK      0x03
+#define ZCL_FRAME_TYPE_PROFILE   0x00
+#define ZCL_FRAME_MANUF_SPECIFIC BIT(2)
+#define ZCL_CMD_READ_ATTRIBUTES  0x00
+/* Frame control, sequence number and command ID */
+#define ZCL_HDR_LEN              3
+
+/* Only updated from the thread handling reads */
+static struct lazy_sampling_stats stats;
+
+bool lazy_sampling_is_read_of(const uint8_t *zcl, size_t len, uint16_t attr_id)
+{
+	if (len < ZCL_HDR_LEN || (zcl[0] & ZCL_FRAME_TYPE_MASK) != ZCL_FRAME_TYPE_PROFILE ||
+	    (zcl[0] & ZCL_FRAME_MANUF_SPECIFIC) || zcl[2] != ZCL_CMD_READ_ATTRIBUTES) {
+		return false;
+	}
+
+	for (size_t i = ZCL_HDR_LEN; i + sizeof(uint16_t) <= len; i += sizeof(uint16_t)) {
+		if (sys_get_le16(&zcl[i]) == attr_id) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int lazy_sampling_on_read(lazy_sampling_publish_t publish)
+{
+	uint32_t start_cyc = k_cycle_get_32();
+	uint32_t latency_us;
+	int ret;
+
+	stats.reads++;
+
+	if (humidity_temperature_svc_get_sample_age_ms() <= MAX_AGE_MSEC) {
+		return -EALREADY;
+	}
+
+	ret = humidity_temperature_svc_try_measurement();
+	if (ret == -EBUSY) {
+		/* The periodic sample is being taken, it is at most one conversion newer */
+		stats.busy++;
+		return ret;
+	} else if (ret != 0) {
+		stats.sample_failures++;
+		LOG_WRN("On-demand sample failed, answering with the cached value");
+		return ret;
+	}
+
+	publish();
+
+	latency_us = k_cyc_to_us_floor32(k_cycle_get_32() - start_cyc);
+	stats.fresh_samples++;
+	stats.last_latency_us = latency_us;
+	stats.max_latency_us = MAX(stats.max_latency_us, latency_us);
+
+	LOG_DBG("Sampled on read in %u us (%u of %u reads)", latency_us, stats.fresh_samples,
+		stats.reads);
+
+	return 0;
+}
+
+void lazy_sampling_get_stats(struct lazy_sampling_stats *out)
+{
+	*out = stats;
+	out->skipped_samples = humidity_temperature_svc_get_skipped_periods();
+}
+
+void lazy_sampling_log_stats(void)
+{
+	struct lazy_sampling_stats s;
+
+	lazy_sampling_get_stats(&s);
+
+	LOG_INF("Lazy sampling: %u reads, %u sampled, %u busy, %u failed, %u skipped", s.reads,
+		s.fresh_samples, s.busy, s.sample_failures, s.skipped_samples);
+	LOG_INF("Read to response latency: last %u us, max %u us", s.last_latency_us,
+		s.max_latency_us);
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_LAZY_SAMPLING_H
+#define APP_LAZY_SAMPLING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct lazy_sampling_stats {
+	/* Read Attributes requests for a MeasuredValue */
+	uint32_t reads;
+	/* Reads that found the cached sample too old and sampled again */
+	uint32_t fresh_samples;
+	/* Reads answered from the cache because a sample was already in progress */
+	uint32_t busy;
+	/* On-demand samples that failed, the cached value was returned */
+	uint32_t sample_failures;
+	/* Time from the read to the attributes holding the fresh sample */
+	uint32_t last_latency_us;
+	uint32_t max_latency_us;
+	/* Periods of CONFIG_MEASURING_PERIOD_SECONDS that passed without a sample */
+	uint32_t skipped_samples;
+};
+
+/**
+ * @brief Callback writing the last sample to the measurement attributes.
+ */
+typedef void (*lazy_sampling_publish_t)(void);
+
+/**
+ * @brief Check whether a ZCL frame reads an attribute.
+ *
+ * @param[in] zcl ZCL frame, starting with the frame control field.
+ * @param[in] len Length of the frame.
+ * @param[in] attr_id Attribute looked for.
+ *
+ * @return true for a profile-wide Read Attributes command that includes attr_id.
+ */
+bool lazy_sampling_is_read_of(const uint8_t *zcl, size_t len, uint16_t attr_id);
+
+/**
+ * @brief Sample again if the cached sample is too old for a read.
+ *
+ * @details Called before the read response is built, so a fresh sample is part of the response.
+ *          Blocks the caller for one conversion when the cached sample is older than
+ *          CONFIG_LAZY_SAMPLING_MAX_AGE_SECONDS. A read arriving while a sample is in progress
+ *          is answered from the cache instead of waiting.
+ *
+ * @param[in] publish Called after a fresh sample to update the attributes.
+ *
+ * @return 0 if a fresh sample was published, -EALREADY if the cached one is recent enough,
+ *         -EBUSY if a sample is in progress, or a negative error code if sampling failed.
+ */
+int lazy_sampling_on_read(lazy_sampling_publish_t publish);
+
+/**
+ * @brief Get the on-demand sampling counters.
+ *
+ * @param[out] stats Counters since boot.
+ */
+void lazy_sampling_get_stats(struct lazy_sampling_stats *stats);
+
+/**
+ * @brief Log the on-demand sampling counters and the read to response latency.
+ */
+void lazy_sampling_log_stats(void);
+
+#endif /* APP_LAZY_SAMPLING_H */
@@ -7,15 +7,103 @@
 #include <zephyr/logging/log.h>
 #include <zephyr/sys/reboot.h>
 
+#include "boot_profile.h"
+#include "device_pm_svc.h"
 #include "events_svc.h"
 #include "humidity_temperature_svc.h"
+#include "lazy_sampling.h"
+#include "power_svc.h"
+#include "rule_svc.h"
+#include "sample_pipeline.h"
 #include "user_interface.h"
+
+#if defined(CONFIG_APP_RADIO_ZIGBEE)
 #include "zigbee_svc.h"
+#elif defined(CONFIG_APP_RADIO_BLE_BTHOME)
+#include "ble_svc.h"
+#elif defined(CONFIG_APP_RADIO_ZIGBEE_GPD)
+#include "gpd_svc.h"
+#endif
 
 LOG_MODULE_REGISTER(main, LOG_LEVEL_INF);
 
+#if defined(CONFIG_LAZY_SAMPLING)
+/* Reads sample on demand, the periodic sample is only a heartbeat */
+#define MEASUREMENT_PERIOD_MSEC      (1000 * CONFIG_LAZY_SAMPLING_HEARTBEAT_SECONDS)
+#else
 #define MEASUREMENT_PERIOD_MSEC      (1000 * CONFIG_MEASURING_PERIOD_SECONDS)
+#endif
 #define FIRST_MEASUREMENT_DELAY_MSEC (1000 * CONFIG_FIRST_MEASUREMENT_DELAY_SECONDS)
+#define FACTORY_RESET_REBOOT_MSEC    1000
+
+#if defined(CONFIG_APP_RADIO_ZIGBEE)
+static void publish_values(int16_t temperature, uint16_t humidity, uint32_t sampled_cyc)
+{
+	if (zigbee_svc_update_measurements(temperature, humidity, sampled_cyc) != 0) {
+		LOG_ERR("Failed to update ZCL measurement attributes!");
+	}
+
+	if (IS_ENABLED(CONFIG_THRESHOLD_RULES)) {
+		rule_svc_evaluate(temperature, humidity);
+	}
+}
+
+static void publish_measurements(void)
+{
+	int16_t temperature = humidity_temperature_svc_get_temperature() *
+			      ZCL_TEMPERATURE_MEASUREMENT_MEASURED_VALUE_MULTIPLIER;
+	uint16_t humidity = humidity_temperature_svc_get_humidity() *
+			    ZCL_HUMIDITY_MEASUREMENT_MEASURED_VALUE_MULTIPLIER;
+
+	publish_values(temperature, humidity, k_cycle_get_32());
+}
+
+/* Runs in the sampling thread of the pipeline, the means come back through publish_values() */
+static int sample_source(int16_t *temperature, uint16_t *humidity)
+{
+	int ret = humidity_temperature_svc_trigger_measurement();
+
+	if (ret != 0) {
+		LOG_ERR("Failed to trigger humidity and temperature measurement: %d", ret);
+		return ret;
+	}
+
+	*temperature = humidity_temperature_svc_get_temperature() *
+		       ZCL_TEMPERATURE_MEASUREMENT_MEASURED_VALUE_MULTIPLIER;
+	*humidity = humidity_temperature_svc_get_humidity() *
+		    ZCL_HUMIDITY_MEASUREMENT_MEASURED_VALUE_MULTIPLIER;
+
+	return 0;
+}
+#elif defined(CONFIG_APP_RADIO_BLE_BTHOME)
+static void publish_measurements(void)
+{
+	int16_t temperature =
+		humidity_temperature_svc_get_temperature() * BTHOME_TEMPERATURE_MULTIPLIER;
+	uint16_t humidity = humidity_temperature_svc_get_humidity() * BTHOME_HUMIDITY_MULTIPLIER;
+
+	if (ble_svc_update_measurements(temperature, humidity) != 0) {
+		LOG_ERR("Failed to advertise measurements!");
+		return;
+	}
+
+	boot_profile_mark(BOOT_MILESTONE_FIRST_REPORT_QUEUED);
+}
+#elif defined(CONFIG_APP_RADIO_ZIGBEE_GPD)
+static void publish_measurements(void)
+{
+	int16_t temperature =
+		humidity_temperature_svc_get_temperature() * GPD_TEMPERATURE_MULTIPLIER;
+	uint16_t humidity = humidity_temperature_svc_get_humidity() * GPD_HUMIDITY_MULTIPLIER;
+
+	if (gpd_svc_send_measurements(temperature, humidity) != 0) {
+		LOG_ERR("Failed to send Green Power report!");
+		return;
+	}
+
+	boot_profile_mark(BOOT_MILESTONE_FIRST_REPORT_QUEUED);
+}
+#endif
 
 static void measuring_work_handler(struct k_work *_work)
 {
@@ -26,31 +114,64 @@ static void measuring_work_handler(struct k_work *_work)
 	if (ret != 0) {
 		LOG_ERR("Failed to trigger humidity and temperature measurement: %d", ret);
 	} else {
-		ret = zigbee_svc_schedule_fn(
-			ZIGBEE_UPDATE_TEMPERATURE_ATTRIBUTE,
-			humidity_temperature_svc_get_temperature() *
-				ZCL_TEMPERATURE_MEASUREMENT_MEASURED_VALUE_MULTIPLIER);
-		if (ret != 0) {
-			LOG_ERR("Failed to update ZCL temperature attribute!");
-		}
-
-		ret = zigbee_svc_schedule_fn(
-			ZIGBEE_UPDATE_HUMIDITY_ATTRIBUTE,
-			humidity_temperature_svc_get_humidity() *
-				ZCL_HUMIDITY_MEASUREMENT_MEASURED_VALUE_MULTIPLIER);
-		if (ret != 0) {
-			LOG_ERR("Failed to update ZCL humidity attribute!");
-		}
+		publish_measurements();
 	}
 
 	k_work_reschedule(work, K_MSEC(MEASUREMENT_PERIOD_MSEC));
 }
 K_WORK_DELAYABLE_DEFINE(measuring_work, measuring_work_handler);
 
+static void reboot_work_handler(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	(void)ui_set_status_led_off();
+	sys_reboot(SYS_REBOOT_COLD);
+}
+K_WORK_DELAYABLE_DEFINE(reboot_work, reboot_work_handler);
+
+static void event_handler(const struct event *evt)
+{
+	LOG_INF("Event: %s", events_svc_type_to_text(evt->type));
+
+	switch (evt->type) {
+	case EVENT_NETWORK_CONNECTED:
+		/* The sample pipeline has a sampling thread of its own */
+		if (!IS_ENABLED(CONFIG_SAMPLE_PIPELINE)) {
+			k_work_reschedule(&measuring_work,
+					  K_MSEC(CONFIG_FIRST_MEASUREMENT_DELAY_SECONDS));
+		}
+		if (IS_ENABLED(CONFIG_UNJOINED_SYSTEM_OFF)) {
+			power_svc_network_joined();
+		}
+		break;
+
+	case EVENT_NETWORK_NOT_CONNECTED:
+		/* Runs on the same workqueue as measuring_work, so a plain cancel is enough */
+		k_work_cancel_delayable(&measuring_work);
+		if (IS_ENABLED(CONFIG_UNJOINED_SYSTEM_OFF)) {
+			power_svc_network_not_joined();
+		}
+		break;
+
+	case EVENT_ZIGBEE_DATA_WIPED:
+		/* Trigger software reboot after performing factory reset, without blocking the
+		 * workqueue while the stack finishes the leave
+		 */
+		LOG_WRN("Rebooting device after performing factory reset . . .");
+		k_work_reschedule(&reboot_work, K_MSEC(FACTORY_RESET_REBOOT_MSEC));
+		break;
+
+	default:
+		break;
+	}
+}
+
 static void btn_callback(enum button_evt evt)
 {
 	int ret;
 	switch (evt) {
+#if defined(CONFIG_APP_RADIO_ZIGBEE)
 	case BUTTON_EVT_PRESSED_1_SEC:
 		ret = zigbee_svc_schedule_fn(ZIGBEE_START_JOINING, 0);
 		if (ret != 0) {
@@ -59,15 +180,67 @@ static void btn_callback(enum button_evt evt)
 
 		break;
 
-	case BUTTON_EVT_PRESSED_3_SEC:
+#if defined(CONFIG_ZIGBEE_ROLE_END_DEVICE)
+	case BUTTON_EVT_CLICK_HOLD:
+		ret = zigbee_svc_schedule_fn(ZIGBEE_START_FAST_POLL,
+					     CONFIG_FAST_POLL_WINDOW_SECONDS);
+		if (ret != 0) {
+			LOG_ERR("Failed to start fast poll window!");
+		}
 		break;
+#endif
 
 	case BUTTON_EVT_PRESSED_10_SEC:
-		ret = zigbee_svc_schedule_fn(ZIGBEE_WIPE_DATA, 0);
+		ret = zigbee_svc_schedule_fn(ZIGBEE_FACTORY_RESET, 0);
 		if (ret != 0) {
 			LOG_ERR("Failed to wipe zigbee data!");
 		}
 		break;
+#elif defined(CONFIG_APP_RADIO_BLE_BTHOME)
+	case BUTTON_EVT_PRESSED_1_SEC:
+		ret = ble_svc_advertise_now();
+		if (ret != 0) {
+			LOG_ERR("Failed to advertise measurements!");
+		}
+		break;
+#elif defined(CONFIG_APP_RADIO_ZIGBEE_GPD)
+	case BUTTON_EVT_PRESSED_1_SEC:
+		ret = gpd_svc_commission();
+		if (ret != 0) {
+			LOG_ERR("Failed to send commissioning frame!");
+		}
+		break;
+
+	case BUTTON_EVT_PRESSED_10_SEC:
+		ret = gpd_svc_decommission();
+		if (ret != 0) {
+			LOG_ERR("Failed to send decommissioning frame!");
+		}
+		break;
+#endif
+
+	case BUTTON_EVT_PRESSED_3_SEC:
+		events_svc_log_stats();
+		if (IS_ENABLED(CONFIG_DEVICE_RUNTIME_PM)) {
+			device_pm_svc_log_stats();
+		}
+		if (IS_ENABLED(CONFIG_LAZY_SAMPLING)) {
+			lazy_sampling_log_stats();
+		}
+		if (IS_ENABLED(CONFIG_SAMPLE_PIPELINE)) {
+			sample_pipeline_log_stats();
+		}
+#if defined(CONFIG_APP_RADIO_ZIGBEE)
+		zigbee_svc_log_reporting_stats();
+#endif
+		break;
+
+	case BUTTON_EVT_DOUBLE_CLICK:
+		/* Measurements are only scheduled while the device is in a network */
+		if (k_work_delayable_is_pending(&measuring_work)) {
+			k_work_reschedule(&measuring_work, K_NO_WAIT);
+		}
+		break;
 
 	default:
 		break;
@@ -78,57 +251,76 @@ int main(void)
 {
 	int ret;
 
+	boot_profile_mark(BOOT_MILESTONE_MAIN);
+
 	LOG_INF("Starting up .. .. ..");
 
+	if (IS_ENABLED(CONFIG_UNJOINED_SYSTEM_OFF)) {
+		power_svc_init();
+	}
+	boot_profile_mark(BOOT_MILESTONE_POWER_INIT);
+
+	if (IS_ENABLED(CONFIG_DEVICE_RUNTIME_PM)) {
+		if (device_pm_svc_init() != 0) {
+			LOG_ERR("Failed to initialize device power management!");
+		}
+	}
+
 	ret = humidity_temperature_svc_init();
 	if (ret != 0) {
 		LOG_ERR("Failed to initialize humidity and temperature service!");
 	}
+	boot_profile_mark(BOOT_MILESTONE_SENSOR_INIT);
 
-	if (ui_gpio_init() != 0) {
-		LOG_ERR("Failed to initialize GPIOs!");
-	}
+	/* Events are handled on the system workqueue, the main thread ends after init */
+	events_svc_register_handler(event_handler);
 
-	ui_register_button_callback(btn_callback);
+#if defined(CONFIG_APP_RADIO_ZIGBEE)
+	if (IS_ENABLED(CONFIG_SAMPLE_PIPELINE)) {
+		sample_pipeline_init(sample_source, publish_values);
+	}
 
 	zigbee_svc_init();
-
 	zigbee_svc_start();
+#elif defined(CONFIG_APP_RADIO_BLE_BTHOME)
+	ret = ble_svc_init();
+	if (ret != 0) {
+		LOG_ERR("Failed to initialize BLE service!");
+	} else {
+		/* There is no network to join, start measuring right away */
+		k_work_reschedule(&measuring_work, K_MSEC(FIRST_MEASUREMENT_DELAY_MSEC));
+	}
+#elif defined(CONFIG_APP_RADIO_ZIGBEE_GPD)
+	ret = gpd_svc_init();
+	if (ret != 0) {
+		LOG_ERR("Failed to initialize Green Power service!");
+	} else {
+		/* Reports go out from the first measurement, commissioning is done by the button */
+		k_work_reschedule(&measuring_work, K_MSEC(FIRST_MEASUREMENT_DELAY_MSEC));
+	}
+#endif
 
-	while (true) {
-		struct event evt;
+	/* Nothing before the radio start needs the UI. LED patterns requested by the stack
+	 * meanwhile are not visible, the pin is only configured here.
+	 */
+	if (ui_gpio_init() != 0) {
+		LOG_ERR("Failed to initialize GPIOs!");
+	}
 
-		/* Wait for the next event */
-		ret = events_svc_get_event(&evt);
-		if (ret != 0) {
-			LOG_WRN("Unable to get event. Err: %d", ret);
-			continue;
-		}
+	ui_register_button_callback(btn_callback);
+	boot_profile_mark(BOOT_MILESTONE_UI_INIT);
 
-		LOG_INF("Event: %s", events_svc_type_to_text(evt.type));
+	boot_profile_mark(BOOT_MILESTONE_MAIN_DONE);
 
-		switch (evt.type) {
-		case EVENT_NETWORK_CONNECTED:
-			k_work_reschedule(&measuring_work,
-					  K_MSEC(CONFIG_FIRST_MEASUREMENT_DELAY_SECONDS));
-			break;
-
-		case EVENT_NETWORK_NOT_CONNECTED:
-			struct k_work_sync sync;
-			k_work_cancel_delayable_sync(&measuring_work, &sync);
-			break;
-
-		case EVENT_ZIGBEE_DATA_WIPED:
-			/* Trigger software reboot after performing factory reset */
-			LOG_WRN("Rebooting device after performing factory reset . . .");
-			k_msleep(1000);
-			(void)ui_set_status_led_off();
-			sys_reboot(SYS_REBOOT_COLD);
-			break;
-
-		default:
-			break;
+	if (IS_ENABLED(CONFIG_INIT_STACKS)) {
+		size_t unused;
+
+		/* The main stack is only used by init, lower CONFIG_MAIN_STACK_SIZE from this */
+		if (k_thread_stack_space_get(k_current_get(), &unused) == 0) {
+			LOG_INF("Main stack: %zu of %d bytes used", CONFIG_MAIN_STACK_SIZE - unused,
+				CONFIG_MAIN_STACK_SIZE);
 		}
 	}
+
 	return 0;
 }
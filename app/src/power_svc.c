@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/hwinfo.h>
+#include <zephyr/logging/log_ctrl.h>
+#include <zephyr/sys/poweroff.h>
+
+#include <hal/nrf_power.h>
+
+#include "power_svc.h"
+#include "user_interface.h"
+#include "zigbee_svc.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(power_svc, LOG_LEVEL_DBG);
+
+/* GPREGRET is used by sys_reboot(), GPREGRET2 keeps the state block through System OFF */
+#define STATE_BLOCK_GPREGRET    1
+#define STATE_BLOCK_MAGIC       0xA0
+#define STATE_BLOCK_MAGIC_MASK  0xF0
+#define STATE_BLOCK_RETRIES_MAX 0x0F
+
+/* Estimated average current of the board in each state, sensor idle included */
+static const uint32_t state_current_na[] = {
+	[POWER_STATE_COMMISSIONING] = 6000000,
+	[POWER_STATE_JOINED] = 20000,
+	[POWER_STATE_RETRY_WAIT] = 2500,
+	[POWER_STATE_OFF] = 500,
+};
+
+static const char *const state_names[] = {
+	[POWER_STATE_COMMISSIONING] = "commissioning",
+	[POWER_STATE_JOINED] = "joined",
+	[POWER_STATE_RETRY_WAIT] = "retry wait",
+	[POWER_STATE_OFF] = "off",
+};
+
+static enum power_state state = POWER_STATE_COMMISSIONING;
+static uint8_t retries;
+
+static void power_svc_set_state(enum power_state new_state)
+{
+	if (new_state == state) {
+		return;
+	}
+
+	state = new_state;
+	LOG_INF("Power state: %s (est. %u nA)", state_names[state], state_current_na[state]);
+}
+
+static void power_svc_enter_system_off(void)
+{
+	int ret;
+
+	ret = ui_enable_button_wakeup();
+	if (ret != 0) {
+		LOG_ERR("Failed to enable button wake-up, staying in System ON: %d", ret);
+		return;
+	}
+
+	nrf_power_gpregret_set(NRF_POWER, STATE_BLOCK_GPREGRET,
+			       STATE_BLOCK_MAGIC | MIN(retries, STATE_BLOCK_RETRIES_MAX));
+
+	power_svc_set_state(POWER_STATE_OFF);
+	(void)ui_set_status_led_off();
+
+	LOG_PANIC();
+	sys_poweroff();
+}
+
+static void retry_work_handler(struct k_work *work)
+{
+	int ret;
+
+	ARG_UNUSED(work);
+
+	if (retries >= CONFIG_UNJOINED_RETRY_COUNT) {
+		LOG_WRN("No network found after %u retries, entering System OFF", retries);
+		power_svc_enter_system_off();
+		return;
+	}
+
+	retries++;
+	LOG_INF("Restarting commissioning (retry %u of %u)", retries, CONFIG_UNJOINED_RETRY_COUNT);
+
+	power_svc_set_state(POWER_STATE_COMMISSIONING);
+	ret = zigbee_svc_schedule_fn(ZIGBEE_START_JOINING, 0);
+	if (ret != 0) {
+		LOG_ERR("Failed to start joining procedure!");
+	}
+}
+static K_WORK_DELAYABLE_DEFINE(retry_work, retry_work_handler);
+
+enum power_state power_svc_get_state(void)
+{
+	return state;
+}
+
+uint32_t power_svc_estimated_current_na(enum power_state s)
+{
+	return state_current_na[s];
+}
+
+void power_svc_network_joined(void)
+{
+	k_work_cancel_delayable(&retry_work);
+	retries = 0;
+	power_svc_set_state(POWER_STATE_JOINED);
+}
+
+void power_svc_network_not_joined(void)
+{
+	/*
+	 * The stack keeps rejoining for ZB_DEV_REJOIN_TIMEOUT_MS and reports each failure,
+	 * the retry timer only expires once it gave up.
+	 */
+	power_svc_set_state(POWER_STATE_RETRY_WAIT);
+	k_work_reschedule(&retry_work, K_SECONDS(CONFIG_UNJOINED_RETRY_PERIOD_SECONDS));
+}
+
+void power_svc_init(void)
+{
+	uint32_t cause = 0;
+	uint8_t block = nrf_power_gpregret_get(NRF_POWER, STATE_BLOCK_GPREGRET);
+
+	nrf_power_gpregret_set(NRF_POWER, STATE_BLOCK_GPREGRET, 0);
+
+	(void)hwinfo_get_reset_cause(&cause);
+	(void)hwinfo_clear_reset_cause();
+
+	if ((block & STATE_BLOCK_MAGIC_MASK) != STATE_BLOCK_MAGIC) {
+		return;
+	}
+
+	LOG_INF("Woke up from System OFF (%s) after %u commissioning retries, resuming",
+		(cause & RESET_LOW_POWER_WAKE) ? "user button" : "reset",
+		block & STATE_BLOCK_RETRIES_MAX);
+}
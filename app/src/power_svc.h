@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_POWER_SVC_H_
+#define APP_POWER_SVC_H_
+
+#include <stdint.h>
+
+enum power_state {
+	/* Scanning for or rejoining a network, radio in RX most of the time */
+	POWER_STATE_COMMISSIONING,
+	/* Sleepy End Device in a network */
+	POWER_STATE_JOINED,
+	/* System ON idle between commissioning attempts, radio off */
+	POWER_STATE_RETRY_WAIT,
+	/* System OFF, only the user button wakes the device */
+	POWER_STATE_OFF,
+};
+
+/**
+ * @brief Get the current power state.
+ *
+ * @return Current power state.
+ */
+enum power_state power_svc_get_state(void);
+
+/**
+ * @brief Get the estimated average current drawn in a power state.
+ *
+ * @param state Power state.
+ *
+ * @return Estimated current in nA.
+ */
+uint32_t power_svc_estimated_current_na(enum power_state state);
+
+/**
+ * @brief Notify the service that the device joined a network.
+ */
+void power_svc_network_joined(void);
+
+/**
+ * @brief Notify the service that the device is not in a network.
+ *
+ * @details Every notification restarts the retry timer. Once it expires, commissioning is
+ *          restarted up to CONFIG_UNJOINED_RETRY_COUNT times before the device enters System OFF.
+ */
+void power_svc_network_not_joined(void);
+
+/**
+ * @brief Restore the state saved before System OFF.
+ *
+ * @details Commissioning resumes on its own once the Zigbee stack starts, this only reports why
+ *          the device was asleep and clears the saved state.
+ */
+void power_svc_init(void);
+
+#endif /* APP_POWER_SVC_H_ */
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+
+#include "report_window.h"
+
+#define MEASURING_PERIOD_MSEC (1000 * CONFIG_MEASURING_PERIOD_SECONDS)
+
+/* Only used from the ZBOSS thread */
+static struct report_window_stats stats;
+static uint32_t pending;
+/* When the last report of each attribute was seen to leave, -1 until one was */
+static int64_t last_report_ms[REPORT_WINDOW_MAX_ATTRS] = {
+	[0 ... REPORT_WINDOW_MAX_ATTRS - 1] = -1,
+};
+
+/* The periodic report would leave on its own by the next measurement */
+static bool max_interval_expires(const struct report_window_attr *attr, size_t idx,
+				 int64_t now_ms)
+{
+	if (attr->max_interval_s == 0 || last_report_ms[idx] < 0) {
+		return false;
+	}
+
+	return last_report_ms[idx] + attr->max_interval_s * MSEC_PER_SEC <=
+	       now_ms + MEASURING_PERIOD_MSEC;
+}
+
+uint32_t report_window_update(const struct report_window_attr *attrs, size_t count,
+			      int64_t now_ms, bool coalesce)
+{
+	uint32_t was_pending = pending;
+	uint32_t forced = 0;
+
+	__ASSERT_NO_MSG(count <= REPORT_WINDOW_MAX_ATTRS);
+
+	for (size_t i = 0; i < count; i++) {
+		if (attrs[i].flagged && !(pending & BIT(i))) {
+			pending |= BIT(i);
+			stats.reports++;
+		}
+	}
+
+	/* The radio wakes up anyway, take the reports that would need the next wake-up */
+	for (size_t i = 0; coalesce && pending != 0 && i < count; i++) {
+		if (attrs[i].configured && !(pending & BIT(i)) &&
+		    max_interval_expires(&attrs[i], i, now_ms)) {
+			pending |= BIT(i);
+			forced |= BIT(i);
+			stats.reports++;
+			stats.forced++;
+		}
+	}
+
+	if (was_pending == 0 && pending != 0) {
+		stats.radio_windows++;
+	}
+
+	return forced;
+}
+
+bool report_window_check(const struct report_window_attr *attrs, size_t count, int64_t now_ms)
+{
+	if (pending == 0) {
+		return false;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		/* A removed rule sends nothing more */
+		if ((pending & BIT(i)) && (!attrs[i].configured || !attrs[i].flagged)) {
+			pending &= ~BIT(i);
+			last_report_ms[i] = now_ms;
+		}
+	}
+
+	return pending == 0;
+}
+
+bool report_window_is_open(void)
+{
+	return pending != 0;
+}
+
+void report_window_reset(void)
+{
+	pending = 0;
+	for (size_t i = 0; i < ARRAY_SIZE(last_report_ms); i++) {
+		last_report_ms[i] = -1;
+	}
+}
+
+void report_window_get_stats(struct report_window_stats *out)
+{
+	*out = stats;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_REPORT_WINDOW_H
+#define APP_REPORT_WINDOW_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Attributes tracked per window, one bit each */
+#define REPORT_WINDOW_MAX_ATTRS 8
+
+/* Reporting state of one attribute, read from the stack by the caller */
+struct report_window_attr {
+	/* A reporting rule is configured for the attribute */
+	bool configured;
+	/* The attribute is marked for reporting and its report has not left yet */
+	bool flagged;
+	/* Maximum reporting interval of the rule in seconds, 0 if reports are not periodic */
+	uint16_t max_interval_s;
+};
+
+struct report_window_stats {
+	/* Radio windows opened by at least one due report */
+	uint32_t radio_windows;
+	/* Reports sent in these windows, including forced ones */
+	uint32_t reports;
+	/* Reports sent ahead of their maximum interval to share a window */
+	uint32_t forced;
+};
+
+/**
+ * @brief Account for the reports due after an attribute update.
+ *
+ * @details Flagged attributes join the open window, or open a new one. With @p coalesce, a
+ *          window being opened anyway also takes the attributes whose maximum reporting
+ *          interval would expire before the next measurement, so their periodic report does
+ *          not need a wake-up of its own.
+ *
+ * @param[in] attrs Reporting state of the attributes.
+ * @param[in] count Number of attributes, at most REPORT_WINDOW_MAX_ATTRS.
+ * @param[in] now_ms Current uptime.
+ * @param[in] coalesce Force reports that would otherwise leave in a later window.
+ *
+ * @return Bit mask of the attributes the caller must mark for reporting.
+ */
+uint32_t report_window_update(const struct report_window_attr *attrs, size_t count,
+			      int64_t now_ms, bool coalesce);
+
+/**
+ * @brief Check which reports of the open window have left.
+ *
+ * @param[in] attrs Reporting state of the attributes.
+ * @param[in] count Number of attributes, at most REPORT_WINDOW_MAX_ATTRS.
+ * @param[in] now_ms Current uptime.
+ *
+ * @return true if the window was open and all of its reports have left.
+ */
+bool report_window_check(const struct report_window_attr *attrs, size_t count, int64_t now_ms);
+
+/**
+ * @brief Check whether reports of the last window are still waiting to leave.
+ */
+bool report_window_is_open(void);
+
+/**
+ * @brief Forget the open window and the report times, the counters are kept.
+ *
+ * @details Called when the reporting rules are removed with the network data.
+ */
+void report_window_reset(void);
+
+/**
+ * @brief Get the window counters.
+ *
+ * @param[out] stats Counters since boot.
+ */
+void report_window_get_stats(struct report_window_stats *stats);
+
+#endif /* APP_REPORT_WINDOW_H */
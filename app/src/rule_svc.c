@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/spinlock.h>
+
+#include "rule_svc.h"
+#include "zigbee_svc.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(rule_svc, LOG_LEVEL_DBG);
+
+#define RULE_SETTINGS_KEY "rules"
+#define RULE_CONFIG_KEY   "cfg"
+
+enum rule_output {
+	RULE_OUTPUT_UNKNOWN,
+	RULE_OUTPUT_OFF,
+	RULE_OUTPUT_ON,
+};
+
+/* Saved as raw bytes, the offsets of the first layout are kept */
+BUILD_ASSERT(sizeof(struct threshold_rule) == 10 &&
+	     offsetof(struct threshold_rule, on_threshold) == 2);
+
+static struct threshold_rule rule;
+/* The rule was replaced since the last evaluation, or cleared since the last save */
+static bool rule_changed;
+static bool rule_cleared;
+static struct k_spinlock rule_lock;
+
+/* Only touched from the evaluating thread */
+static enum rule_output output = RULE_OUTPUT_UNKNOWN;
+static enum rule_output pending_output = RULE_OUTPUT_UNKNOWN;
+static int64_t pending_since_ms;
+
+static bool rule_is_valid(const struct threshold_rule *r)
+{
+	if (r->source == RULE_SOURCE_DISABLED) {
+		return true;
+	}
+
+	return (r->source == RULE_SOURCE_HUMIDITY || r->source == RULE_SOURCE_TEMPERATURE) &&
+	       r->on_threshold > r->off_threshold;
+}
+
+static int rule_settings_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+	struct threshold_rule stored;
+	ssize_t ret;
+
+	if (!settings_name_steq(name, RULE_CONFIG_KEY, NULL)) {
+		return -ENOENT;
+	}
+
+	if (len != sizeof(stored)) {
+		LOG_WRN("Discarding rule of unexpected size %zu", len);
+		return 0;
+	}
+
+	ret = read_cb(cb_arg, &stored, sizeof(stored));
+	if (ret < 0) {
+		LOG_ERR("Failed to read rule: %d", ret);
+		return ret;
+	}
+
+	if (rule_is_valid(&stored)) {
+		rule = stored;
+		/* Saved as padding by earlier versions */
+		rule.reserved = 0;
+	}
+
+	return 0;
+}
+SETTINGS_STATIC_HANDLER_DEFINE(rule, RULE_SETTINGS_KEY, NULL, rule_settings_set, NULL, NULL);
+
+/* Flash writes are kept out of the ZBOSS thread that delivers attribute writes */
+static void rule_save_work_handler(struct k_work *work)
+{
+	struct threshold_rule copy;
+	k_spinlock_key_t key;
+	bool cleared;
+	int ret;
+
+	ARG_UNUSED(work);
+
+	key = k_spin_lock(&rule_lock);
+	copy = rule;
+	cleared = rule_cleared;
+	rule_cleared = false;
+	k_spin_unlock(&rule_lock, key);
+
+	if (cleared) {
+		ret = settings_delete(RULE_SETTINGS_KEY "/" RULE_CONFIG_KEY);
+		if (ret != 0) {
+			LOG_ERR("Failed to delete rule: %d", ret);
+		}
+		return;
+	}
+
+	ret = settings_save_one(RULE_SETTINGS_KEY "/" RULE_CONFIG_KEY, &copy, sizeof(copy));
+	if (ret != 0) {
+		LOG_ERR("Failed to save rule: %d", ret);
+	}
+}
+static K_WORK_DEFINE(rule_save_work, rule_save_work_handler);
+
+void rule_svc_get_config(struct threshold_rule *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&rule_lock);
+
+	*out = rule;
+	k_spin_unlock(&rule_lock, key);
+}
+
+int rule_svc_set_config(const struct threshold_rule *in)
+{
+	k_spinlock_key_t key;
+
+	if (!rule_is_valid(in)) {
+		LOG_WRN("Rejecting rule: source %u, on %d, off %d", in->source, in->on_threshold,
+			in->off_threshold);
+		return -EINVAL;
+	}
+
+	key = k_spin_lock(&rule_lock);
+	rule = *in;
+	rule.reserved = 0;
+	rule_changed = true;
+	rule_cleared = false;
+	k_spin_unlock(&rule_lock, key);
+
+	LOG_INF("Rule: source %u, on above %d for %u s, off below %d for %u s", in->source,
+		in->on_threshold, in->on_delay_s, in->off_threshold, in->off_delay_s);
+
+	k_work_submit(&rule_save_work);
+
+	return 0;
+}
+
+void rule_svc_clear(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&rule_lock);
+
+	memset(&rule, 0, sizeof(rule));
+	rule_changed = true;
+	rule_cleared = true;
+	k_spin_unlock(&rule_lock, key);
+
+	/* A save still queued writes nothing after this */
+	k_work_submit(&rule_save_work);
+}
+
+void rule_svc_evaluate(int16_t temperature, uint16_t humidity)
+{
+	struct threshold_rule r;
+	enum rule_output wanted;
+	int64_t now_ms = k_uptime_get();
+	k_spinlock_key_t key;
+	uint32_t delay_ms;
+	int32_t value;
+	bool changed;
+	int ret;
+
+	key = k_spin_lock(&rule_lock);
+	r = rule;
+	changed = rule_changed;
+	rule_changed = false;
+	k_spin_unlock(&rule_lock, key);
+
+	/* The delay of a pending transition counts from a sample of the new rule */
+	if (changed) {
+		pending_output = RULE_OUTPUT_UNKNOWN;
+	}
+
+	if (r.source == RULE_SOURCE_DISABLED) {
+		pending_output = RULE_OUTPUT_UNKNOWN;
+		return;
+	}
+
+	value = (r.source == RULE_SOURCE_HUMIDITY) ? humidity : temperature;
+
+	if (value > r.on_threshold) {
+		wanted = RULE_OUTPUT_ON;
+	} else if (value < r.off_threshold) {
+		wanted = RULE_OUTPUT_OFF;
+	} else {
+		/* Inside the hysteresis band, any pending transition starts over */
+		pending_output = RULE_OUTPUT_UNKNOWN;
+		return;
+	}
+
+	if (wanted == output) {
+		pending_output = RULE_OUTPUT_UNKNOWN;
+		return;
+	}
+
+	if (wanted != pending_output) {
+		pending_output = wanted;
+		pending_since_ms = now_ms;
+	}
+
+	delay_ms = MSEC_PER_SEC * ((wanted == RULE_OUTPUT_ON) ? r.on_delay_s : r.off_delay_s);
+	if (now_ms - pending_since_ms < delay_ms) {
+		return;
+	}
+
+	LOG_INF("Value %d past the threshold, sending %s to bound devices", value,
+		(wanted == RULE_OUTPUT_ON) ? "On" : "Off");
+
+	ret = zigbee_svc_schedule_fn(ZIGBEE_SEND_ON_OFF, wanted == RULE_OUTPUT_ON);
+	if (ret != 0) {
+		LOG_ERR("Failed to send On/Off command: %d", ret);
+		/* Retried with the next sample */
+		return;
+	}
+
+	output = wanted;
+	pending_output = RULE_OUTPUT_UNKNOWN;
+}
+
+int rule_svc_init(void)
+{
+	int ret;
+
+	ret = settings_subsys_init();
+	if (ret != 0) {
+		LOG_ERR("Failed to initialize settings: %d", ret);
+		return ret;
+	}
+
+	ret = settings_load_subtree(RULE_SETTINGS_KEY);
+	if (ret != 0) {
+		LOG_ERR("Failed to load rule: %d", ret);
+		return ret;
+	}
+
+	LOG_DBG("Rule: source %u, on %d, off %d", rule.source, rule.on_threshold,
+		rule.off_threshold);
+
+	return 0;
+}
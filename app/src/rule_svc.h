@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_RULE_SVC_H_
+#define APP_RULE_SVC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+enum rule_source {
+	RULE_SOURCE_DISABLED,
+	/* Relative humidity in 0.01 % */
+	RULE_SOURCE_HUMIDITY,
+	/* Temperature in 0.01 degrees Celsius */
+	RULE_SOURCE_TEMPERATURE,
+};
+
+/**
+ * @brief Threshold rule with hysteresis.
+ *
+ * @details On is sent to the bound devices once the source stayed above on_threshold for
+ *          on_delay_s, Off once it stayed below off_threshold for off_delay_s. Values between
+ *          the thresholds keep the current output. on_threshold must be above off_threshold.
+ *          Persisted as is, the layout has no implicit padding.
+ */
+struct threshold_rule {
+	uint8_t source;
+	/* Must be 0 */
+	uint8_t reserved;
+	int16_t on_threshold;
+	int16_t off_threshold;
+	uint16_t on_delay_s;
+	uint16_t off_delay_s;
+};
+
+/**
+ * @brief Restore the persisted rule.
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+int rule_svc_init(void);
+
+/**
+ * @brief Get the active rule.
+ *
+ * @param[out] rule Rule configuration.
+ */
+void rule_svc_get_config(struct threshold_rule *rule);
+
+/**
+ * @brief Replace the rule and persist it.
+ *
+ * @details The output state is kept, a pending transition starts over with the next sample.
+ *
+ * @param[in] rule Rule configuration.
+ *
+ * @return 0 on success, -EINVAL if the thresholds do not leave a hysteresis band.
+ */
+int rule_svc_set_config(const struct threshold_rule *rule);
+
+/**
+ * @brief Disable the rule and delete the persisted one (used when the Zigbee data is wiped).
+ */
+void rule_svc_clear(void);
+
+/**
+ * @brief Evaluate the rule against a new sample.
+ *
+ * @details Constant cost per sample, only the start of a pending transition is remembered.
+ *
+ * @param[in] temperature Temperature in 0.01 degrees Celsius.
+ * @param[in] humidity Relative humidity in 0.01 %.
+ */
+void rule_svc_evaluate(int16_t temperature, uint16_t humidity);
+
+#endif /* APP_RULE_SVC_H_ */
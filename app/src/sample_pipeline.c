@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/spinlock.h>
+
+#include "sample_pipeline.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(sample_pipeline, LOG_LEVEL_DBG);
+
+#define SAMPLING_STACK_SIZE 1024
+/* Below the system workqueue, which drains the ring and must keep up with the samples */
+#define SAMPLING_PRIORITY   K_PRIO_PREEMPT(1)
+
+struct sample {
+	int16_t temperature;
+	uint16_t humidity;
+	uint32_t timestamp_cyc;
+};
+
+static struct sample ring[CONFIG_SAMPLE_PIPELINE_RING_SIZE];
+static size_t ring_head;
+static size_t ring_count;
+static struct k_spinlock ring_lock;
+
+/* Decimation window, only touched by the drain work */
+static int32_t temperature_sum;
+static uint32_t humidity_sum;
+static uint32_t window_count;
+
+static sample_pipeline_source_t source_cb;
+static sample_pipeline_output_t output_cb;
+static struct sample_pipeline_stats stats;
+static int64_t first_sample_ms = -1;
+
+static K_THREAD_STACK_DEFINE(sampling_stack, SAMPLING_STACK_SIZE);
+static struct k_thread sampling_thread;
+
+static bool ring_get(struct sample *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&ring_lock);
+	bool found = ring_count > 0;
+
+	if (found) {
+		*out = ring[(ring_head + ARRAY_SIZE(ring) - ring_count) % ARRAY_SIZE(ring)];
+		ring_count--;
+	}
+	k_spin_unlock(&ring_lock, key);
+
+	return found;
+}
+
+static void decimate(const struct sample *sample)
+{
+	k_spinlock_key_t key;
+	uint32_t latency_us;
+
+	temperature_sum += sample->temperature;
+	humidity_sum += sample->humidity;
+
+	if (++window_count < CONFIG_SAMPLE_PIPELINE_DECIMATION) {
+		return;
+	}
+
+	if (output_cb != NULL) {
+		output_cb(temperature_sum / (int32_t)window_count, humidity_sum / window_count,
+			  sample->timestamp_cyc);
+	}
+
+	latency_us = k_cyc_to_us_floor32(k_cycle_get_32() - sample->timestamp_cyc);
+
+	key = k_spin_lock(&ring_lock);
+	stats.outputs++;
+	stats.last_latency_us = latency_us;
+	stats.max_latency_us = MAX(stats.max_latency_us, latency_us);
+	k_spin_unlock(&ring_lock, key);
+
+	temperature_sum = 0;
+	humidity_sum = 0;
+	window_count = 0;
+}
+
+static void drain_work_handler(struct k_work *work)
+{
+	struct sample sample;
+
+	ARG_UNUSED(work);
+
+	while (ring_get(&sample)) {
+		decimate(&sample);
+	}
+}
+static K_WORK_DEFINE(drain_work, drain_work_handler);
+
+int sample_pipeline_push(int16_t temperature, uint16_t humidity)
+{
+	k_spinlock_key_t key = k_spin_lock(&ring_lock);
+	int64_t now_ms = k_uptime_get();
+	int ret = 0;
+
+	if (first_sample_ms < 0) {
+		first_sample_ms = now_ms;
+	}
+	stats.elapsed_ms = (uint32_t)(now_ms - first_sample_ms);
+
+	if (ring_count == ARRAY_SIZE(ring)) {
+		stats.dropped++;
+		ret = -ENOBUFS;
+	} else {
+		ring[ring_head] = (struct sample){
+			.temperature = temperature,
+			.humidity = humidity,
+			.timestamp_cyc = k_cycle_get_32(),
+		};
+		ring_head = (ring_head + 1) % ARRAY_SIZE(ring);
+		ring_count++;
+		stats.samples++;
+	}
+	k_spin_unlock(&ring_lock, key);
+
+	k_work_submit(&drain_work);
+
+	return ret;
+}
+
+static void sampling_thread_fn(void *p1, void *p2, void *p3)
+{
+	int64_t next_ms = k_uptime_get();
+	int16_t temperature;
+	uint16_t humidity;
+	k_spinlock_key_t key;
+
+	ARG_UNUSED(p1);
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	while (true) {
+		if (source_cb(&temperature, &humidity) == 0) {
+			if (sample_pipeline_push(temperature, humidity) != 0) {
+				LOG_WRN("Sample pipeline full, sample dropped");
+			}
+		} else {
+			key = k_spin_lock(&ring_lock);
+			stats.source_errors++;
+			k_spin_unlock(&ring_lock, key);
+		}
+
+		/* Absolute deadlines, the sampling time does not add up over the periods */
+		next_ms += CONFIG_SAMPLE_PIPELINE_PERIOD_MS;
+		k_sleep(K_TIMEOUT_ABS_MS(next_ms));
+	}
+}
+
+void sample_pipeline_get_stats(struct sample_pipeline_stats *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&ring_lock);
+
+	*out = stats;
+	k_spin_unlock(&ring_lock, key);
+}
+
+void sample_pipeline_log_stats(void)
+{
+	struct sample_pipeline_stats s;
+	uint32_t rate_mhz = 0;
+
+	sample_pipeline_get_stats(&s);
+
+	/* N samples span N - 1 periods */
+	if (s.samples > 1 && s.elapsed_ms > 0) {
+		rate_mhz = (uint32_t)((uint64_t)(s.samples - 1) * 1000000 / s.elapsed_ms);
+	}
+
+	LOG_INF("Pipeline: %u samples in %u ms (%u.%03u Hz), %u dropped, %u failed, %u outputs",
+		s.samples, s.elapsed_ms, rate_mhz / 1000, rate_mhz % 1000, s.dropped,
+		s.source_errors, s.outputs);
+	LOG_INF("Sample to output latency: last %u us, max %u us", s.last_latency_us,
+		s.max_latency_us);
+}
+
+void sample_pipeline_init(sample_pipeline_source_t source, sample_pipeline_output_t output)
+{
+	source_cb = source;
+	output_cb = output;
+
+	LOG_INF("Sampling every %d ms, one update per %d samples",
+		CONFIG_SAMPLE_PIPELINE_PERIOD_MS, CONFIG_SAMPLE_PIPELINE_DECIMATION);
+
+	k_thread_create(&sampling_thread, sampling_stack, K_THREAD_STACK_SIZEOF(sampling_stack),
+			sampling_thread_fn, NULL, NULL, NULL, SAMPLING_PRIORITY, 0, K_NO_WAIT);
+	k_thread_name_set(&sampling_thread, "sample_pipeline");
+}
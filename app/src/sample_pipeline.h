@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_SAMPLE_PIPELINE_H
+#define APP_SAMPLE_PIPELINE_H
+
+#include <stdint.h>
+
+struct sample_pipeline_stats {
+	/* Samples pushed into the ring buffer */
+	uint32_t samples;
+	/* Periods where the source failed to deliver a sample */
+	uint32_t source_errors;
+	/* Samples lost because the ring buffer was full */
+	uint32_t dropped;
+	/* Decimated values handed to the output callback */
+	uint32_t outputs;
+	/* Time between the first and the last sample pushed */
+	uint32_t elapsed_ms;
+	/* Time from the newest sample of a decimation window to the output callback returning */
+	uint32_t last_latency_us;
+	uint32_t max_latency_us;
+};
+
+/**
+ * @brief Callback taking one sample, called from the sampling thread.
+ *
+ * @param[out] temperature Temperature sample.
+ * @param[out] humidity Humidity sample.
+ *
+ * @return 0 on success, negative error code if no sample was taken.
+ */
+typedef int (*sample_pipeline_source_t)(int16_t *temperature, uint16_t *humidity);
+
+/**
+ * @brief Callback receiving the decimated values.
+ *
+ * @param[in] temperature Mean temperature of the decimation window, in the units pushed.
+ * @param[in] humidity Mean humidity of the decimation window, in the units pushed.
+ * @param[in] sampled_cyc k_cycle_get_32() when the newest sample of the window was pushed.
+ */
+typedef void (*sample_pipeline_output_t)(int16_t temperature, uint16_t humidity,
+					 uint32_t sampled_cyc);
+
+/**
+ * @brief Push a sample into the pipeline.
+ *
+ * @details Called by the sampling thread with every sample of the source. The sample is
+ *          queued in the ring buffer and drained from the system workqueue.
+ *          Every CONFIG_SAMPLE_PIPELINE_DECIMATION samples the mean is passed to the output
+ *          callback.
+ *
+ * @param[in] temperature Temperature sample.
+ * @param[in] humidity Humidity sample.
+ *
+ * @return 0 on success, -ENOBUFS if the ring buffer is full.
+ */
+int sample_pipeline_push(int16_t temperature, uint16_t humidity);
+
+/**
+ * @brief Get the throughput and latency counters.
+ *
+ * @param[out] stats Counters since boot.
+ */
+void sample_pipeline_get_stats(struct sample_pipeline_stats *stats);
+
+/**
+ * @brief Log the sustained sample rate and the latency counters.
+ */
+void sample_pipeline_log_stats(void);
+
+/**
+ * @brief Initialize the pipeline and start the sampling thread.
+ *
+ * @details The thread calls the source every CONFIG_SAMPLE_PIPELINE_PERIOD_MS, independent of
+ *          the time the source and the output take, and pushes the samples.
+ *
+ * @param[in] source Callback taking a sample, called from the sampling thread.
+ * @param[in] output Callback receiving the decimated values, called from the system workqueue.
+ */
+void sample_pipeline_init(sample_pipeline_source_t source, sample_pipeline_output_t output);
+
+#endif /* APP_SAMPLE_PIPELINE_H */
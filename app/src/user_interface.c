@@ -5,6 +5,7 @@
  */
 
 #include <zephyr/kernel.h>
+#include <zephyr/spinlock.h>
 #include <zephyr/device.h>
 #include <zephyr/devicetree.h>
 #include <zephyr/drivers/gpio.h>
@@ -15,7 +16,16 @@
 
 LOG_MODULE_REGISTER(user_interface, LOG_LEVEL_DBG);
 
-#define LED_ON_TIME_MS 200
+#define BUTTON_DEBOUNCE_MS       15
+/* Presses shorter than this count as clicks of a gesture */
+#define BUTTON_CLICK_MAX_MS      500
+/* Time to wait for the next click of a gesture after a click was released */
+#define BUTTON_GESTURE_WINDOW_MS 400
+/* Hold duration after which BUTTON_EVT_PRESSED_10_SEC is reported */
+#define BUTTON_HOLD_FEEDBACK_MS                                                                    \
+	((BUTTON_EVT_PRESSED_10_SEC - BUTTON_EVT_PRESSED_1_SEC) * MSEC_PER_SEC)
+/* Longer holds after a click match no gesture */
+#define BUTTON_CLICK_HOLD_MAX_MS (5 * MSEC_PER_SEC)
 
 static const struct gpio_dt_spec user_button = GPIO_DT_SPEC_GET(DT_ALIAS(sw0), gpios);
 static const struct gpio_dt_spec status_led = GPIO_DT_SPEC_GET(DT_ALIAS(led0), gpios);
@@ -23,50 +33,164 @@ static const struct gpio_dt_spec status_led = GPIO_DT_SPEC_GET(DT_ALIAS(led0), g
 static struct gpio_callback user_button_cb_data;
 static void (*button_callback)(enum button_evt evt) = NULL;
 
-static enum button_evt btn_event = BUTTON_EVT_NONE;
+struct button_gesture {
+	/* Number of clicks preceding the final press */
+	uint8_t clicks;
+	/* Duration range of the final press */
+	uint32_t min_press_ms;
+	uint32_t max_press_ms;
+	enum button_evt evt;
+};
 
-static void button_increase_time(struct k_work *_work)
+static const struct button_gesture gestures[] = {
+	{
+		.clicks = 1,
+		.min_press_ms = 0,
+		.max_press_ms = BUTTON_CLICK_MAX_MS - 1,
+		.evt = BUTTON_EVT_DOUBLE_CLICK,
+	},
+	{
+		.clicks = 1,
+		.min_press_ms = 2 * MSEC_PER_SEC,
+		.max_press_ms = BUTTON_CLICK_HOLD_MAX_MS - 1,
+		.evt = BUTTON_EVT_CLICK_HOLD,
+	},
+};
+
+/* Uptime of the first edge of the last bounce burst, set from the GPIO interrupt */
+static volatile uint32_t edge_time_ms;
+static uint32_t press_time_ms;
+static uint32_t last_click_ms;
+static uint8_t clicks;
+static bool pressed;
+
+static void hold_feedback_expiry_fn(struct k_timer *timer)
+{
+	ui_play_led_pattern(UI_LED_PATTERN_FACTORY_RESET);
+}
+K_TIMER_DEFINE(hold_feedback_timer, hold_feedback_expiry_fn, NULL);
+
+static enum button_evt button_hold_event(uint32_t duration_ms)
 {
-	struct k_work_delayable *work = k_work_delayable_from_work(_work);
+	uint32_t seconds = duration_ms / MSEC_PER_SEC;
 
-	if (btn_event < BUTTON_EVT_PRESSED_10_SEC) /* Last press event */ {
-		btn_event++;
-		k_work_reschedule(work, K_SECONDS(1));
+	return MIN(BUTTON_EVT_PRESSED_1_SEC + seconds, BUTTON_EVT_PRESSED_10_SEC);
+}
+
+static enum button_evt button_match_gesture(uint8_t preceding_clicks, uint32_t duration_ms)
+{
+	if (preceding_clicks == 0) {
+		return button_hold_event(duration_ms);
 	}
 
-	if (btn_event == BUTTON_EVT_PRESSED_10_SEC) {
-		ui_set_status_led_on();
+	for (size_t i = 0; i < ARRAY_SIZE(gestures); i++) {
+		if (gestures[i].clicks == preceding_clicks &&
+		    duration_ms >= gestures[i].min_press_ms &&
+		    duration_ms <= gestures[i].max_press_ms) {
+			return gestures[i].evt;
+		}
 	}
+
+	return BUTTON_EVT_NONE;
 }
-K_WORK_DELAYABLE_DEFINE(button_increase_time_work, button_increase_time);
 
-static void button_handler(struct k_work *work)
+static bool button_gesture_can_continue(uint8_t completed_clicks)
 {
-	ARG_UNUSED(work);
-	struct k_work_sync sync;
+	for (size_t i = 0; i < ARRAY_SIZE(gestures); i++) {
+		if (gestures[i].clicks >= completed_clicks) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void button_dispatch(enum button_evt evt)
+{
+	clicks = 0;
+
+	if (evt == BUTTON_EVT_NONE) {
+		LOG_DBG("Unknown button gesture");
+		return;
+	}
 
 	if (button_callback) {
-		int value = gpio_pin_get_dt(&user_button);
-		if (value == 1) /* 1 = pressed, 0 = released */ {
-			btn_event = BUTTON_EVT_PRESSED_1_SEC;
-			k_work_reschedule(&button_increase_time_work, K_SECONDS(1));
-			return;
-		}
-		/* Button released */
-		k_work_cancel_delayable_sync(&button_increase_time_work, &sync);
-		button_callback(btn_event);
-		btn_event = BUTTON_EVT_NONE;
+		button_callback(evt);
 	} else {
 		LOG_WRN("No registered user button callback!");
 	}
 }
+
+static void button_gesture_timeout(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	/* No further press followed the last click */
+	button_dispatch(button_match_gesture(clicks - 1, last_click_ms));
+}
+static K_WORK_DELAYABLE_DEFINE(gesture_work, button_gesture_timeout);
+
+static void button_released(uint32_t duration_ms)
+{
+	if (duration_ms >= BUTTON_CLICK_MAX_MS) {
+		button_dispatch(button_match_gesture(clicks, duration_ms));
+		return;
+	}
+
+	clicks++;
+	last_click_ms = duration_ms;
+
+	if (button_gesture_can_continue(clicks)) {
+		k_work_reschedule(&gesture_work, K_MSEC(BUTTON_GESTURE_WINDOW_MS));
+		return;
+	}
+
+	button_dispatch(button_match_gesture(clicks - 1, duration_ms));
+}
+
+static void button_handler(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	int value = gpio_pin_get_dt(&user_button);
+	if (value < 0) {
+		LOG_ERR("Failed to read user button: %d", value);
+		return;
+	}
+
+	/* 1 = pressed, 0 = released */
+	if ((value == 1) == pressed) {
+		/* Bounce without a level change */
+		return;
+	}
+	pressed = (value == 1);
+
+	if (pressed) {
+		press_time_ms = edge_time_ms;
+		k_work_cancel_delayable(&gesture_work);
+		/* Only a hold without preceding clicks ends in BUTTON_EVT_PRESSED_10_SEC */
+		if (clicks == 0) {
+			k_timer_start(&hold_feedback_timer,
+				      K_MSEC(BUTTON_HOLD_FEEDBACK_MS - BUTTON_DEBOUNCE_MS),
+				      K_NO_WAIT);
+		}
+		return;
+	}
+
+	k_timer_stop(&hold_feedback_timer);
+	button_released(edge_time_ms - press_time_ms);
+}
 static K_WORK_DELAYABLE_DEFINE(debouncing_work, button_handler);
 
 static void button_pressed_callback(const struct device *dev, struct gpio_callback *cb,
 				    uint32_t pins)
 {
-	/* Debounce the button */
-	k_work_reschedule(&debouncing_work, K_MSEC(15));
+	/* Timestamp the first edge of a bounce burst, the level is read once it settled */
+	if (!k_work_delayable_is_pending(&debouncing_work)) {
+		edge_time_ms = k_uptime_get_32();
+	}
+
+	k_work_reschedule(&debouncing_work, K_MSEC(BUTTON_DEBOUNCE_MS));
 }
 
 void ui_register_button_callback(void (*callback)(enum button_evt evt))
@@ -89,20 +213,115 @@ int ui_set_status_led_off(void)
 	return gpio_pin_set_dt(&status_led, 0);
 }
 
-void led_timer_expiry_fn(struct k_timer *time)
+struct led_step {
+	/* Short pulses are perceived dimmer, the on time scales brightness and charge */
+	uint16_t on_ms;
+	uint16_t off_ms;
+};
+
+struct led_pattern {
+	const char *name;
+	const struct led_step *steps;
+	size_t step_count;
+};
+
+#define LED_PATTERN(_name, _steps)                                                                 \
+	{                                                                                          \
+		.name = _name, .steps = _steps, .step_count = ARRAY_SIZE(_steps),                  \
+	}
+
+static const struct led_step joining_steps[] = {{4, 400}, {4, 400}, {4, 0}};
+static const struct led_step joined_steps[] = {{40, 0}};
+static const struct led_step error_steps[] = {{4, 120}, {4, 120}, {4, 120}, {4, 120}, {4, 0}};
+static const struct led_step factory_reset_steps[] = {{60, 200}, {60, 200}, {60, 0}};
+
+static const struct led_pattern led_patterns[] = {
+	[UI_LED_PATTERN_JOINING] = LED_PATTERN("joining", joining_steps),
+	[UI_LED_PATTERN_JOINED] = LED_PATTERN("joined", joined_steps),
+	[UI_LED_PATTERN_ERROR] = LED_PATTERN("error", error_steps),
+	[UI_LED_PATTERN_FACTORY_RESET] = LED_PATTERN("factory_reset", factory_reset_steps),
+};
+
+/* Sequencer state. Patterns are started from threads and from the hold feedback timer
+ * interrupt, and stepped from the led_timer interrupt, so it is only touched under led_lock.
+ */
+static const struct led_pattern *active_pattern;
+static size_t active_step;
+static bool active_step_on;
+static struct k_spinlock led_lock;
+
+static void led_step_start(void);
+
+static void led_timer_expiry_fn(struct k_timer *timer)
 {
-	ui_set_status_led_off();
+	k_spinlock_key_t key = k_spin_lock(&led_lock);
+	const struct led_step *step = &active_pattern->steps[active_step];
+
+	if (active_step_on) {
+		ui_set_status_led_off();
+		active_step_on = false;
+
+		if (step->off_ms != 0) {
+			k_timer_start(timer, K_MSEC(step->off_ms), K_NO_WAIT);
+			k_spin_unlock(&led_lock, key);
+			return;
+		}
+	}
+
+	active_step++;
+	if (active_step < active_pattern->step_count) {
+		led_step_start();
+	}
+	k_spin_unlock(&led_lock, key);
 }
 K_TIMER_DEFINE(led_timer, led_timer_expiry_fn, NULL);
 
-int ui_flash_status_led(uint32_t on_time_ms)
+/* Called with led_lock held */
+static void led_step_start(void)
+{
+	ui_set_status_led_on();
+	active_step_on = true;
+	k_timer_start(&led_timer, K_MSEC(active_pattern->steps[active_step].on_ms), K_NO_WAIT);
+}
+
+uint32_t ui_led_pattern_charge_nc(enum ui_led_pattern pattern)
+{
+	const struct led_pattern *p = &led_patterns[pattern];
+	uint32_t on_time_ms = 0;
+
+	for (size_t i = 0; i < p->step_count; i++) {
+		on_time_ms += p->steps[i].on_ms;
+	}
+
+	/* uA * ms = nC */
+	return on_time_ms * CONFIG_STATUS_LED_CURRENT_UA;
+}
+
+int ui_play_led_pattern(enum ui_led_pattern pattern)
 {
-	int ret = ui_set_status_led_on();
-	if (ret == 0) {
-		k_timer_start(&led_timer, K_MSEC(on_time_ms), K_NO_WAIT);
-		return 0;
+	k_spinlock_key_t key;
+
+	if (pattern >= ARRAY_SIZE(led_patterns)) {
+		return -EINVAL;
 	}
-	return ret;
+
+	key = k_spin_lock(&led_lock);
+	k_timer_stop(&led_timer);
+	active_pattern = &led_patterns[pattern];
+	active_step = 0;
+	led_step_start();
+	k_spin_unlock(&led_lock, key);
+
+	LOG_DBG("LED pattern %s: %u nC", led_patterns[pattern].name,
+		ui_led_pattern_charge_nc(pattern));
+
+	return 0;
+}
+
+int ui_enable_button_wakeup(void)
+{
+	/* A level interrupt uses GPIO SENSE, which also wakes the SoC from System OFF */
+	return gpio_pin_interrupt_configure_dt(&user_button, GPIO_INT_LEVEL_ACTIVE);
 }
 
 int ui_gpio_init(void)
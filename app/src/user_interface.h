@@ -7,6 +7,8 @@
 #ifndef APP_USER_INTERFACE_H_
 #define APP_USER_INTERFACE_H_
 
+#include <stdint.h>
+
 enum button_evt {
 	BUTTON_EVT_NONE,
 	BUTTON_EVT_PRESSED_1_SEC,
@@ -19,6 +21,17 @@ enum button_evt {
 	BUTTON_EVT_PRESSED_8_SEC,
 	BUTTON_EVT_PRESSED_9_SEC,
 	BUTTON_EVT_PRESSED_10_SEC,
+	/* Two short clicks */
+	BUTTON_EVT_DOUBLE_CLICK,
+	/* Short click followed by a press held for 2 to 5 seconds */
+	BUTTON_EVT_CLICK_HOLD,
+};
+
+enum ui_led_pattern {
+	UI_LED_PATTERN_JOINING,
+	UI_LED_PATTERN_JOINED,
+	UI_LED_PATTERN_ERROR,
+	UI_LED_PATTERN_FACTORY_RESET,
 };
 
 /**
@@ -50,13 +63,32 @@ int ui_set_status_led_on(void);
 int ui_set_status_led_off(void);
 
 /**
- * @brief flash the status LED.
+ * @brief Play a status LED pattern.
+ *
+ * @details Patterns are short pulse sequences stepped by a single timer. Starting a pattern
+ *          aborts the one currently playing.
  *
- * @param on_time_ms On time in ms
+ * @param pattern Pattern to play.
+ *
+ * @return 0 on success, -EINVAL for an unknown pattern.
+ */
+int ui_play_led_pattern(enum ui_led_pattern pattern);
+
+/**
+ * @brief Get the charge drawn from the battery by the status LED for a pattern.
+ *
+ * @param pattern Pattern to evaluate.
+ *
+ * @return Charge in nC, based on CONFIG_STATUS_LED_CURRENT_UA.
+ */
+uint32_t ui_led_pattern_charge_nc(enum ui_led_pattern pattern);
+
+/**
+ * @brief Configure the user button to wake the device from System OFF.
  *
  * @return 0 on success, negative error code on failure.
  */
-int ui_flash_status_led(uint32_t on_time_ms);
+int ui_enable_button_wakeup(void);
 
 /**
  * @brief Initialize GPIOs for user button and status LED.
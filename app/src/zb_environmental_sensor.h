@@ -35,23 +35,75 @@
 
 /* Temperature sensor device version */
 #define ZB_HA_DEVICE_VER_TEMPERATURE_SENSOR       0
-/* Basic, temperature, humidity */
-#define ZB_HA_ENVIRONMENTAL_SENSOR_IN_CLUSTER_NUM 3
+/* Basic, temperature, humidity, diagnostics */
+#define ZB_HA_ENVIRONMENTAL_SENSOR_IN_CLUSTER_NUM 4
 
-#define ZB_HA_ENVIRONMENTAL_SENSOR_OUT_CLUSTER_NUM 0
+/* On/Off client, driven by the threshold rule */
+#define ZB_HA_ENVIRONMENTAL_SENSOR_OUT_CLUSTER_NUM 1
 
 /* Temperature, humidity */
 #define ZB_HA_ENVIRONMENTAL_SENSOR_REPORT_ATTR_COUNT 2
 
+/* Diagnostics cluster attributes according to ZCL Spec 3.15.2.2 */
+#define ENVIRONMENTAL_SENSOR_ATTR_DIAG_MAC_TX_UCAST_RETRY_ID 0x0104
+#define ENVIRONMENTAL_SENSOR_ATTR_DIAG_MAC_TX_UCAST_FAIL_ID  0x0105
+#define ENVIRONMENTAL_SENSOR_ATTR_DIAG_LAST_MESSAGE_LQI_ID   0x011C
+#define ENVIRONMENTAL_SENSOR_ATTR_DIAG_LAST_MESSAGE_RSSI_ID  0x011D
+
+/* Manufacturer-specific Diagnostics attributes, declared with CONFIG_SENSOR_MANUFACTURER_CODE */
+#define ENVIRONMENTAL_SENSOR_ATTR_DIAG_POLL_FAILURES_ID  0x4000
+#define ENVIRONMENTAL_SENSOR_ATTR_DIAG_PARENT_CHANGES_ID 0x4001
+#define ENVIRONMENTAL_SENSOR_ATTR_DIAG_REJOINS_ID        0x4002
+#define ENVIRONMENTAL_SENSOR_ATTR_DIAG_LINK_FAILURES_ID  0x4003
+
+/* Manufacturer-specific Relative Humidity cluster attributes configuring the threshold rule */
+#define ENVIRONMENTAL_SENSOR_ATTR_RULE_SOURCE_ID        0x4000
+#define ENVIRONMENTAL_SENSOR_ATTR_RULE_ON_THRESHOLD_ID  0x4001
+#define ENVIRONMENTAL_SENSOR_ATTR_RULE_OFF_THRESHOLD_ID 0x4002
+#define ENVIRONMENTAL_SENSOR_ATTR_RULE_ON_DELAY_ID      0x4003
+#define ENVIRONMENTAL_SENSOR_ATTR_RULE_OFF_DELAY_ID     0x4004
+
+#ifndef ZB_ZCL_DIAGNOSTICS_CLUSTER_REVISION_DEFAULT
+#define ZB_ZCL_DIAGNOSTICS_CLUSTER_REVISION_DEFAULT ((zb_uint16_t)0x0003u)
+#endif
+
+/** @brief Declare a read-only attribute backed by a RAM counter
+    @param attr_id - attribute identifier
+    @param attr_type - ZCL attribute type
+    @param manuf - manufacturer code, ZB_ZCL_MANUF_CODE_INVALID for standard attributes
+    @param data_ptr - pointer to the attribute value
+ */
+#define ENVIRONMENTAL_SENSOR_SET_RO_ATTR_DESC(attr_id, attr_type, manuf, data_ptr)                 \
+	{.id = (attr_id),                                                                          \
+	 .type = (attr_type),                                                                      \
+	 .access = ZB_ZCL_ATTR_ACCESS_READ_ONLY |                                                  \
+		   ((manuf) == ZB_ZCL_MANUF_CODE_INVALID ? 0 : ZB_ZCL_ATTR_MANUF_SPEC),            \
+	 .manuf_code = (manuf),                                                                    \
+	 .data_p = (void *)(data_ptr)},
+
+/** @brief Declare a writable manufacturer-specific attribute
+    @param attr_id - attribute identifier
+    @param attr_type - ZCL attribute type
+    @param data_ptr - pointer to the attribute value
+ */
+#define ENVIRONMENTAL_SENSOR_SET_RW_MANUF_ATTR_DESC(attr_id, attr_type, data_ptr)                  \
+	{.id = (attr_id),                                                                          \
+	 .type = (attr_type),                                                                      \
+	 .access = ZB_ZCL_ATTR_ACCESS_READ_WRITE | ZB_ZCL_ATTR_MANUF_SPEC,                        \
+	 .manuf_code = CONFIG_SENSOR_MANUFACTURER_CODE,                                            \
+	 .data_p = (void *)(data_ptr)},
+
 /** @brief Declare cluster list for environmental sensor device
     @param cluster_list_name - cluster list variable name
     @param basic_attr_list - attribute list for Basic cluster
     @param temperature_measurement_attr_list - attribute list for temperature measurement cluster
     @param humidity_measurement_attr_list - attribute list for humidity measurement cluster
+    @param diagnostics_attr_list - attribute list for diagnostics cluster
  */
 #define ZB_HA_DECLARE_ENVIRONMENTAL_SENSOR_CLUSTER_LIST(cluster_list_name, basic_attr_list,        \
 							temperature_measurement_attr_list,         \
-							humidity_measurement_attr_list)            \
+							humidity_measurement_attr_list,            \
+							diagnostics_attr_list)                     \
 	zb_zcl_cluster_desc_t cluster_list_name[] = {                                              \
 		ZB_ZCL_CLUSTER_DESC(ZB_ZCL_CLUSTER_ID_BASIC,                                       \
 				    ZB_ZCL_ARRAY_SIZE(basic_attr_list, zb_zcl_attr_t),             \
@@ -67,6 +119,12 @@
 			ZB_ZCL_ARRAY_SIZE(humidity_measurement_attr_list, zb_zcl_attr_t),          \
 			(humidity_measurement_attr_list), ZB_ZCL_CLUSTER_SERVER_ROLE,              \
 			ZB_ZCL_MANUF_CODE_INVALID),                                                \
+		ZB_ZCL_CLUSTER_DESC(ZB_ZCL_CLUSTER_ID_DIAGNOSTICS,                                 \
+				    ZB_ZCL_ARRAY_SIZE(diagnostics_attr_list, zb_zcl_attr_t),       \
+				    (diagnostics_attr_list), ZB_ZCL_CLUSTER_SERVER_ROLE,           \
+				    ZB_ZCL_MANUF_CODE_INVALID),                                    \
+		ZB_ZCL_CLUSTER_DESC(ZB_ZCL_CLUSTER_ID_ON_OFF, 0, NULL,                             \
+				    ZB_ZCL_CLUSTER_CLIENT_ROLE, ZB_ZCL_MANUF_CODE_INVALID),        \
 	}
 
 #define ZB_ZCL_DECLARE_ENVIRONMENTAL_SENSOR_DESC(ep_name, ep_id, in_clust_num, out_clust_num)      \
@@ -83,6 +141,8 @@
 					 ZB_ZCL_CLUSTER_ID_BASIC,                                  \
 					 ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT,                       \
 					 ZB_ZCL_CLUSTER_ID_REL_HUMIDITY_MEASUREMENT,               \
+					 ZB_ZCL_CLUSTER_ID_DIAGNOSTICS,                            \
+					 ZB_ZCL_CLUSTER_ID_ON_OFF,                                 \
 				 }}
 
 #define ZB_HA_DECLARE_ENVIRONMENTAL_SENSOR_EP(ep_name, ep_id, cluster_list)                        \
@@ -104,10 +164,34 @@ struct zb_zcl_humidity_measurement_attrs_t {
 	zb_uint16_t max_measure_value;
 };
 
+/**@brief Diagnostics cluster attributes, kept in RAM and only sent when read. */
+struct zb_zcl_diagnostics_attrs_t {
+	zb_uint16_t mac_tx_ucast_retry;
+	zb_uint16_t mac_tx_ucast_fail;
+	zb_uint8_t last_message_lqi;
+	zb_int8_t last_message_rssi;
+	/* Manufacturer-specific */
+	zb_uint16_t poll_failures;
+	zb_uint16_t parent_changes;
+	zb_uint16_t rejoins;
+	zb_uint16_t link_failures;
+};
+
+/**@brief Threshold rule configuration, see rule_svc.h. */
+struct zb_zcl_rule_attrs_t {
+	zb_uint8_t source;
+	zb_int16_t on_threshold;
+	zb_int16_t off_threshold;
+	zb_uint16_t on_delay_s;
+	zb_uint16_t off_delay_s;
+};
+
 struct zb_device_ctx {
 	zb_zcl_basic_attrs_ext_t basic_attr;
 	zb_zcl_temp_measurement_attrs_t temp_attrs;
 	struct zb_zcl_humidity_measurement_attrs_t humidity_attrs;
+	struct zb_zcl_diagnostics_attrs_t diagnostics_attrs;
+	struct zb_zcl_rule_attrs_t rule_attrs;
 };
 
 #endif /* APP_ENVIRONMENTAL_SENSOR_H */
@@ -4,7 +4,11 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <errno.h>
+#include <string.h>
+
 #include <zephyr/kernel.h>
+#include <zephyr/spinlock.h>
 #include <ram_pwrdn.h>
 
 #include <zboss_api.h>
@@ -13,8 +17,13 @@
 #include <zigbee/zigbee_app_utils.h>
 #include <zigbee/zigbee_error_handler.h>
 
+#include "boot_profile.h"
+#include "channel_history_svc.h"
 #include "events_svc.h"
 #include "humidity_temperature_svc.h"
+#include "lazy_sampling.h"
+#include "report_window.h"
+#include "rule_svc.h"
 #include "user_interface.h"
 #include "zigbee_svc.h"
 
@@ -25,10 +34,36 @@ LOG_MODULE_REGISTER(zigbee_svc, LOG_LEVEL_DBG);
 #define KEEP_ALIVE_PERIOD_MSEC (1000 * CONFIG_KEEP_ALIVE_PERIOD_SECONDS)
 #define LONG_POLL_PERIOD_MSEC  (1000 * CONFIG_LONG_POLL_PERIOD_SECONDS)
 #define IEEE_ADDR_BUF_SIZE     17
+/* Checks whether the reports of a radio window have left */
+#define REPORT_CHECK_INTERVAL  ZB_MILLISECONDS_TO_BEACON_INTERVAL(100)
 
 /* Stores all cluster-related attributes */
 static struct zb_device_ctx dev_ctx;
 static bool zigbee_data_wiped;
+static struct zigbee_reporting_stats reporting_stats;
+
+/* Latest measurement, handed over from the application to the ZBOSS thread */
+static struct {
+	zb_int16_t temperature;
+	zb_uint16_t humidity;
+	uint32_t sampled_cyc;
+} pending_measurement;
+static struct k_spinlock pending_measurement_lock;
+
+/* Attributes with a reporting rule, checked together after every measurement */
+static const struct {
+	zb_uint16_t cluster_id;
+	zb_uint16_t attr_id;
+} reported_attrs[] = {
+	{ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT, ZB_ZCL_ATTR_TEMP_MEASUREMENT_VALUE_ID},
+	{ZB_ZCL_CLUSTER_ID_REL_HUMIDITY_MEASUREMENT, ZB_ZCL_ATTR_REL_HUMIDITY_MEASUREMENT_VALUE_ID},
+};
+BUILD_ASSERT(ARRAY_SIZE(reported_attrs) == ZB_HA_ENVIRONMENTAL_SENSOR_REPORT_ATTR_COUNT,
+	     "Every reporting context needs an entry in reported_attrs");
+BUILD_ASSERT(ARRAY_SIZE(reported_attrs) <= REPORT_WINDOW_MAX_ATTRS);
+
+/* MAC source of the last frame received while joined, a SED only hears its parent */
+static zb_uint16_t parent_short_addr = ZB_UNKNOWN_SHORT_ADDR;
 
 /* Declare attribute list for Basic cluster */
 ZB_ZCL_DECLARE_BASIC_ATTRIB_LIST_EXT(basic_attr_list, &dev_ctx.basic_attr.zcl_version, NULL, NULL,
@@ -43,16 +78,69 @@ ZB_ZCL_DECLARE_TEMP_MEASUREMENT_ATTRIB_LIST(temperature_measurement_attr_list,
 					    &dev_ctx.temp_attrs.max_measure_value,
 					    &dev_ctx.temp_attrs.tolerance);
 
-/* Declare attribute list for humidity cluster */
-ZB_ZCL_DECLARE_REL_HUMIDITY_MEASUREMENT_ATTRIB_LIST(humidity_measurement_attr_list,
-						    &dev_ctx.humidity_attrs.measure_value,
-						    &dev_ctx.humidity_attrs.min_measure_value,
-						    &dev_ctx.humidity_attrs.max_measure_value);
+/* Declare attribute list for humidity cluster, with the threshold rule configuration */
+ZB_ZCL_START_DECLARE_ATTRIB_LIST_CLUSTER_REVISION(humidity_measurement_attr_list,
+						  ZB_ZCL_REL_HUMIDITY_MEASUREMENT)
+ZB_ZCL_SET_ATTR_DESC(ZB_ZCL_ATTR_REL_HUMIDITY_MEASUREMENT_VALUE_ID,
+		     &dev_ctx.humidity_attrs.measure_value)
+ZB_ZCL_SET_ATTR_DESC(ZB_ZCL_ATTR_REL_HUMIDITY_MEASUREMENT_MIN_VALUE_ID,
+		     &dev_ctx.humidity_attrs.min_measure_value)
+ZB_ZCL_SET_ATTR_DESC(ZB_ZCL_ATTR_REL_HUMIDITY_MEASUREMENT_MAX_VALUE_ID,
+		     &dev_ctx.humidity_attrs.max_measure_value)
+#if defined(CONFIG_THRESHOLD_RULES)
+ENVIRONMENTAL_SENSOR_SET_RW_MANUF_ATTR_DESC(ENVIRONMENTAL_SENSOR_ATTR_RULE_SOURCE_ID,
+					    ZB_ZCL_ATTR_TYPE_8BIT_ENUM,
+					    &dev_ctx.rule_attrs.source)
+ENVIRONMENTAL_SENSOR_SET_RW_MANUF_ATTR_DESC(ENVIRONMENTAL_SENSOR_ATTR_RULE_ON_THRESHOLD_ID,
+					    ZB_ZCL_ATTR_TYPE_S16,
+					    &dev_ctx.rule_attrs.on_threshold)
+ENVIRONMENTAL_SENSOR_SET_RW_MANUF_ATTR_DESC(ENVIRONMENTAL_SENSOR_ATTR_RULE_OFF_THRESHOLD_ID,
+					    ZB_ZCL_ATTR_TYPE_S16,
+					    &dev_ctx.rule_attrs.off_threshold)
+ENVIRONMENTAL_SENSOR_SET_RW_MANUF_ATTR_DESC(ENVIRONMENTAL_SENSOR_ATTR_RULE_ON_DELAY_ID,
+					    ZB_ZCL_ATTR_TYPE_U16,
+					    &dev_ctx.rule_attrs.on_delay_s)
+ENVIRONMENTAL_SENSOR_SET_RW_MANUF_ATTR_DESC(ENVIRONMENTAL_SENSOR_ATTR_RULE_OFF_DELAY_ID,
+					    ZB_ZCL_ATTR_TYPE_U16,
+					    &dev_ctx.rule_attrs.off_delay_s)
+#endif
+ZB_ZCL_FINISH_DECLARE_ATTRIB_LIST;
+
+/* Declare attribute list for diagnostics cluster, counters are only updated in RAM */
+ZB_ZCL_START_DECLARE_ATTRIB_LIST_CLUSTER_REVISION(diagnostics_attr_list, ZB_ZCL_DIAGNOSTICS)
+ENVIRONMENTAL_SENSOR_SET_RO_ATTR_DESC(ENVIRONMENTAL_SENSOR_ATTR_DIAG_MAC_TX_UCAST_RETRY_ID,
+				      ZB_ZCL_ATTR_TYPE_U16, ZB_ZCL_MANUF_CODE_INVALID,
+				      &dev_ctx.diagnostics_attrs.mac_tx_ucast_retry)
+ENVIRONMENTAL_SENSOR_SET_RO_ATTR_DESC(ENVIRONMENTAL_SENSOR_ATTR_DIAG_MAC_TX_UCAST_FAIL_ID,
+				      ZB_ZCL_ATTR_TYPE_U16, ZB_ZCL_MANUF_CODE_INVALID,
+				      &dev_ctx.diagnostics_attrs.mac_tx_ucast_fail)
+ENVIRONMENTAL_SENSOR_SET_RO_ATTR_DESC(ENVIRONMENTAL_SENSOR_ATTR_DIAG_LAST_MESSAGE_LQI_ID,
+				      ZB_ZCL_ATTR_TYPE_U8, ZB_ZCL_MANUF_CODE_INVALID,
+				      &dev_ctx.diagnostics_attrs.last_message_lqi)
+ENVIRONMENTAL_SENSOR_SET_RO_ATTR_DESC(ENVIRONMENTAL_SENSOR_ATTR_DIAG_LAST_MESSAGE_RSSI_ID,
+				      ZB_ZCL_ATTR_TYPE_S8, ZB_ZCL_MANUF_CODE_INVALID,
+				      &dev_ctx.diagnostics_attrs.last_message_rssi)
+#if defined(CONFIG_SENSOR_MANUFACTURER_ATTRIBUTES)
+ENVIRONMENTAL_SENSOR_SET_RO_ATTR_DESC(ENVIRONMENTAL_SENSOR_ATTR_DIAG_POLL_FAILURES_ID,
+				      ZB_ZCL_ATTR_TYPE_U16, CONFIG_SENSOR_MANUFACTURER_CODE,
+				      &dev_ctx.diagnostics_attrs.poll_failures)
+ENVIRONMENTAL_SENSOR_SET_RO_ATTR_DESC(ENVIRONMENTAL_SENSOR_ATTR_DIAG_PARENT_CHANGES_ID,
+				      ZB_ZCL_ATTR_TYPE_U16, CONFIG_SENSOR_MANUFACTURER_CODE,
+				      &dev_ctx.diagnostics_attrs.parent_changes)
+ENVIRONMENTAL_SENSOR_SET_RO_ATTR_DESC(ENVIRONMENTAL_SENSOR_ATTR_DIAG_REJOINS_ID,
+				      ZB_ZCL_ATTR_TYPE_U16, CONFIG_SENSOR_MANUFACTURER_CODE,
+				      &dev_ctx.diagnostics_attrs.rejoins)
+ENVIRONMENTAL_SENSOR_SET_RO_ATTR_DESC(ENVIRONMENTAL_SENSOR_ATTR_DIAG_LINK_FAILURES_ID,
+				      ZB_ZCL_ATTR_TYPE_U16, CONFIG_SENSOR_MANUFACTURER_CODE,
+				      &dev_ctx.diagnostics_attrs.link_failures)
+#endif
+ZB_ZCL_FINISH_DECLARE_ATTRIB_LIST;
 
 /* Clusters setup */
 ZB_HA_DECLARE_ENVIRONMENTAL_SENSOR_CLUSTER_LIST(environmental_sensor_cluster_list, basic_attr_list,
 						temperature_measurement_attr_list,
-						humidity_measurement_attr_list);
+						humidity_measurement_attr_list,
+						diagnostics_attr_list);
 
 /* Endpoint setup (single) */
 ZB_HA_DECLARE_ENVIRONMENTAL_SENSOR_EP(environmental_sensor_ep, ENVIRONMENTAL_SENSOR_ENDPOINT_NB,
@@ -65,7 +153,10 @@ void zigbee_svc_clusters_init(void)
 {
 	/* Basic cluster attributes */
 	dev_ctx.basic_attr.zcl_version = ZB_ZCL_VERSION;
-	dev_ctx.basic_attr.power_source = ZB_ZCL_BASIC_POWER_SOURCE_BATTERY;
+	/* Routers run from USB or another DC supply */
+	dev_ctx.basic_attr.power_source = IS_ENABLED(CONFIG_ZIGBEE_ROLE_END_DEVICE)
+						  ? ZB_ZCL_BASIC_POWER_SOURCE_BATTERY
+						  : ZB_ZCL_BASIC_POWER_SOURCE_DC_SOURCE;
 
 	/* Use ZB_ZCL_SET_STRING_VAL to set strings, because the first byte
 	 * should contain string length without trailing zero.
@@ -89,6 +180,9 @@ void zigbee_svc_clusters_init(void)
 	dev_ctx.humidity_attrs.measure_value = ZB_ZCL_ATTR_REL_HUMIDITY_MEASUREMENT_VALUE_UNKNOWN;
 	dev_ctx.humidity_attrs.min_measure_value = ENVIRONMENTAL_SENSOR_ATTR_HUMIDITY_MIN;
 	dev_ctx.humidity_attrs.max_measure_value = ENVIRONMENTAL_SENSOR_ATTR_HUMIDITY_MAX;
+
+	/* Diagnostics, counters start from zero on every boot */
+	memset(&dev_ctx.diagnostics_attrs, 0, sizeof(dev_ctx.diagnostics_attrs));
 }
 
 static void zigbee_svc_update_temperature_attribute(zb_bufid_t bufid, zb_uint16_t temperature)
@@ -124,6 +218,238 @@ static void zigbee_svc_update_humidity_attribute(zb_bufid_t bufid, zb_uint16_t h
 	}
 }
 
+/* Saturate instead of wrapping, a wrapped counter reads as a healthy device */
+static inline void diagnostics_counter_inc(zb_uint16_t *counter)
+{
+	if (*counter < UINT16_MAX) {
+		(*counter)++;
+	}
+}
+
+#if defined(CONFIG_DIAGNOSTICS_MAC_COUNTERS)
+static void diagnostics_mac_stats_cb(zb_bufid_t bufid)
+{
+	zdo_diagnostics_full_stats_t *full_stats = zb_buf_begin(bufid);
+
+	if (full_stats->status == RET_OK) {
+		dev_ctx.diagnostics_attrs.mac_tx_ucast_retry =
+			MIN(full_stats->mac_stats.mac_tx_ucast_retries, UINT16_MAX);
+		dev_ctx.diagnostics_attrs.mac_tx_ucast_fail =
+			MIN(full_stats->mac_stats.mac_tx_ucast_failures, UINT16_MAX);
+	}
+
+	zb_buf_free(bufid);
+}
+#endif
+
+/* Copy the MAC counters kept by the stack into the Diagnostics cluster attributes */
+static void diagnostics_refresh_mac_stats(zb_bufid_t bufid)
+{
+	ZVUNUSED(bufid);
+
+#if defined(CONFIG_DIAGNOSTICS_MAC_COUNTERS)
+	zb_ret_t ret = zdo_diagnostics_get_stats(diagnostics_mac_stats_cb,
+						 ZB_PIB_ATTRIBUTE_IEEE_DIAGNOSTIC_INFO);
+	if (ret != RET_OK) {
+		LOG_WRN("Failed to request MAC diagnostics: %d", ret);
+	}
+#endif
+}
+
+/* Profile-wide Read Attributes of MeasuredValue on the temperature or humidity cluster */
+static bool is_measured_value_read(zb_bufid_t bufid, const zb_apsde_data_indication_t *ind)
+{
+	zb_uint16_t value_id;
+
+	if (ind->dst_endpoint != ENVIRONMENTAL_SENSOR_ENDPOINT_NB) {
+		return false;
+	}
+
+	if (ind->clusterid == ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT) {
+		value_id = ZB_ZCL_ATTR_TEMP_MEASUREMENT_VALUE_ID;
+	} else if (ind->clusterid == ZB_ZCL_CLUSTER_ID_REL_HUMIDITY_MEASUREMENT) {
+		value_id = ZB_ZCL_ATTR_REL_HUMIDITY_MEASUREMENT_VALUE_ID;
+	} else {
+		return false;
+	}
+
+	return lazy_sampling_is_read_of(zb_buf_begin(bufid), zb_buf_len(bufid), value_id);
+}
+
+/* Runs in the ZBOSS thread before ZCL builds the read response */
+static void publish_sample_for_read(void)
+{
+	int16_t temperature = humidity_temperature_svc_get_temperature() *
+			      ZCL_TEMPERATURE_MEASUREMENT_MEASURED_VALUE_MULTIPLIER;
+	uint16_t humidity = humidity_temperature_svc_get_humidity() *
+			    ZCL_HUMIDITY_MEASUREMENT_MEASURED_VALUE_MULTIPLIER;
+
+	zigbee_svc_update_temperature_attribute(0, temperature);
+	zigbee_svc_update_humidity_attribute(0, humidity);
+}
+
+/* Called for every APS data frame before it is passed to ZCL, must not consume the buffer */
+static zb_uint8_t data_indication_cb(zb_bufid_t bufid)
+{
+	zb_apsde_data_indication_t *ind = ZB_BUF_GET_PARAM(bufid, zb_apsde_data_indication_t);
+	struct zb_zcl_diagnostics_attrs_t *diag = &dev_ctx.diagnostics_attrs;
+
+	boot_profile_mark(BOOT_MILESTONE_FIRST_RX);
+
+	diag->last_message_lqi = ind->lqi;
+	diag->last_message_rssi = ind->rssi;
+
+	/* A router receives from all its neighbours, only an end device has a parent */
+	if (IS_ENABLED(CONFIG_ZIGBEE_ROLE_END_DEVICE) && ZB_JOINED() &&
+	    ind->mac_src_addr != parent_short_addr) {
+		if (parent_short_addr != ZB_UNKNOWN_SHORT_ADDR) {
+			LOG_INF("Parent changed: 0x%04x -> 0x%04x", parent_short_addr,
+				ind->mac_src_addr);
+			diagnostics_counter_inc(&diag->parent_changes);
+		}
+		parent_short_addr = ind->mac_src_addr;
+	}
+
+	/* Blocks the stack for at most one conversion, reads during a sample get the cache */
+	if (IS_ENABLED(CONFIG_LAZY_SAMPLING) && is_measured_value_read(bufid, ind)) {
+		(void)lazy_sampling_on_read(publish_sample_for_read);
+	}
+
+	return ZB_FALSE;
+}
+
+static zb_zcl_reporting_info_t *find_reporting_info(size_t idx)
+{
+	return zb_zcl_find_reporting_info(ENVIRONMENTAL_SENSOR_ENDPOINT_NB,
+					  reported_attrs[idx].cluster_id,
+					  ZB_ZCL_CLUSTER_SERVER_ROLE, reported_attrs[idx].attr_id);
+}
+
+/* Set when a value change requires a report, cleared once the report has left */
+static bool report_is_due(zb_zcl_reporting_info_t *rep_info)
+{
+	return rep_info != NULL && ZB_ZCL_GET_REPORTING_FLAG(rep_info, ZB_ZCL_REPORT_ATTR);
+}
+
+static void read_report_state(struct report_window_attr *attrs)
+{
+	zb_zcl_reporting_info_t *rep_info;
+
+	for (size_t i = 0; i < ARRAY_SIZE(reported_attrs); i++) {
+		rep_info = find_reporting_info(i);
+		attrs[i].configured = rep_info != NULL;
+		attrs[i].flagged = report_is_due(rep_info);
+		attrs[i].max_interval_s = rep_info != NULL ? rep_info->u.send_info.max_interval : 0;
+	}
+}
+
+static void check_report_window(zb_uint8_t param)
+{
+	struct report_window_attr attrs[ARRAY_SIZE(reported_attrs)];
+
+	ZVUNUSED(param);
+
+	read_report_state(attrs);
+	if (!report_window_check(attrs, ARRAY_SIZE(attrs), k_uptime_get())) {
+		if (report_window_is_open()) {
+			ZB_SCHEDULE_APP_ALARM(check_report_window, 0, REPORT_CHECK_INTERVAL);
+		}
+		return;
+	}
+
+#if defined(CONFIG_ZIGBEE_COALESCED_REPORTING)
+	/* Reports need no response, go back to the long poll instead of polling for one */
+	zb_zdo_pim_turbo_poll_cancel_packet();
+#endif
+}
+
+/* Called in the ZBOSS thread after an attribute update, before the reporting engine runs */
+static void account_due_reports(bool coalesce)
+{
+	struct report_window_attr attrs[ARRAY_SIZE(reported_attrs)];
+	bool was_open = report_window_is_open();
+	uint32_t forced;
+
+	read_report_state(attrs);
+	forced = report_window_update(attrs, ARRAY_SIZE(attrs), k_uptime_get(), coalesce);
+
+	for (size_t i = 0; i < ARRAY_SIZE(reported_attrs); i++) {
+		if (forced & BIT(i)) {
+			zb_zcl_mark_attr_for_reporting(ENVIRONMENTAL_SENSOR_ENDPOINT_NB,
+						       reported_attrs[i].cluster_id,
+						       ZB_ZCL_CLUSTER_SERVER_ROLE,
+						       reported_attrs[i].attr_id);
+		}
+	}
+
+	if (!was_open && report_window_is_open()) {
+		boot_profile_mark(BOOT_MILESTONE_FIRST_REPORT_QUEUED);
+		ZB_SCHEDULE_APP_ALARM(check_report_window, 0, REPORT_CHECK_INTERVAL);
+	}
+}
+
+/* Called in the ZBOSS thread once the attributes hold the measurement. Due reports are built
+ * by the reporting engine right after this callback returns.
+ */
+static void count_measurement(uint32_t sampled_cyc)
+{
+	uint32_t latency_us = k_cyc_to_us_floor32(k_cycle_get_32() - sampled_cyc);
+
+	reporting_stats.measurements++;
+	reporting_stats.last_latency_us = latency_us;
+	reporting_stats.max_latency_us = MAX(reporting_stats.max_latency_us, latency_us);
+}
+
+static void update_measurements(zb_bufid_t bufid)
+{
+	zb_int16_t temperature;
+	zb_uint16_t humidity;
+	uint32_t sampled_cyc;
+	k_spinlock_key_t key;
+
+	ZVUNUSED(bufid);
+
+	key = k_spin_lock(&pending_measurement_lock);
+	temperature = pending_measurement.temperature;
+	humidity = pending_measurement.humidity;
+	sampled_cyc = pending_measurement.sampled_cyc;
+	k_spin_unlock(&pending_measurement_lock, key);
+
+	/* Both values change before the reporting engine runs, so due reports leave together */
+	zigbee_svc_update_temperature_attribute(0, temperature);
+	zigbee_svc_update_humidity_attribute(0, humidity);
+
+	count_measurement(sampled_cyc);
+	account_due_reports(true);
+}
+
+/* Scheduled after the two attribute updates when they are not coalesced */
+static void measurement_applied(zb_bufid_t bufid)
+{
+	uint32_t sampled_cyc;
+	k_spinlock_key_t key;
+
+	ZVUNUSED(bufid);
+
+	key = k_spin_lock(&pending_measurement_lock);
+	sampled_cyc = pending_measurement.sampled_cyc;
+	k_spin_unlock(&pending_measurement_lock, key);
+
+	count_measurement(sampled_cyc);
+}
+
+static void update_temperature(zb_bufid_t bufid, zb_uint16_t temperature)
+{
+	zigbee_svc_update_temperature_attribute(bufid, temperature);
+	account_due_reports(false);
+}
+
+static void update_humidity(zb_bufid_t bufid, zb_uint16_t humidity)
+{
+	zigbee_svc_update_humidity_attribute(bufid, humidity);
+	account_due_reports(false);
+}
+
 static void log_reporting_info(zb_uint8_t endpoint, zb_uint16_t cluster_id, zb_uint16_t attr_id)
 {
 	zb_zcl_reporting_info_t *rep_info;
@@ -152,10 +478,129 @@ static void start_joining(zb_bufid_t bufid)
 
 	if (!ZB_JOINED()) {
 		LOG_WRN("Device not in a network -> Restart joining procedure");
+		if (IS_ENABLED(CONFIG_CHANNEL_HISTORY)) {
+			channel_history_svc_apply_scan_mask();
+			channel_history_svc_scan_started();
+		}
 		bdb_start_top_level_commissioning(ZB_BDB_NETWORK_STEERING);
+		ui_play_led_pattern(UI_LED_PATTERN_JOINING);
 	} else {
 		LOG_INF("Device is already in a network");
-		ui_flash_status_led(250);
+		ui_play_led_pattern(UI_LED_PATTERN_JOINED);
+	}
+}
+
+static void start_fast_poll(zb_bufid_t bufid, zb_uint16_t seconds)
+{
+	ZVUNUSED(bufid);
+
+#if defined(CONFIG_ZIGBEE_ROLE_END_DEVICE)
+	LOG_INF("Fast polling parent for %d seconds", seconds);
+	zb_zdo_pim_start_turbo_poll_continuous(seconds * 1000);
+#else
+	/* Routers keep the receiver on, there is nothing to poll */
+	ZVUNUSED(seconds);
+#endif
+}
+
+static void send_on_off(zb_bufid_t bufid, zb_uint16_t on)
+{
+	zb_uint8_t cmd_id = on ? ZB_ZCL_CMD_ON_OFF_ON_ID : ZB_ZCL_CMD_ON_OFF_OFF_ID;
+
+	/* No destination, the APS layer sends to every device bound to the On/Off client */
+	ZB_ZCL_ON_OFF_SEND_REQ(bufid, 0, ZB_APS_ADDR_MODE_DST_ADDR_ENDP_NOT_PRESENT, 0,
+			       ENVIRONMENTAL_SENSOR_ENDPOINT_NB, ZB_AF_HA_PROFILE_ID,
+			       ZB_ZCL_DISABLE_DEFAULT_RESPONSE, cmd_id, NULL);
+}
+
+static void request_on_off(zb_bufid_t bufid, zb_uint16_t on)
+{
+	zb_ret_t ret;
+
+	ZVUNUSED(bufid);
+
+	ret = zb_buf_get_out_delayed_ext(send_on_off, on, 0);
+	if (ret != RET_OK) {
+		LOG_ERR("Failed to allocate buffer for On/Off command: %d", ret);
+	}
+}
+
+#if defined(CONFIG_THRESHOLD_RULES)
+static void rule_attrs_from_config(const struct threshold_rule *rule)
+{
+	dev_ctx.rule_attrs.source = rule->source;
+	dev_ctx.rule_attrs.on_threshold = rule->on_threshold;
+	dev_ctx.rule_attrs.off_threshold = rule->off_threshold;
+	dev_ctx.rule_attrs.on_delay_s = rule->on_delay_s;
+	dev_ctx.rule_attrs.off_delay_s = rule->off_delay_s;
+}
+
+/* The attributes hold the rule being written, the active rule is only replaced once the
+ * written combination is valid. Writing the thresholds one at a time may pass through an
+ * invalid combination, the previous rule stays active meanwhile.
+ */
+static void rule_attr_written(zb_uint16_t attr_id, const zb_zcl_attr_value_t *value)
+{
+	struct threshold_rule rule = {
+		.source = dev_ctx.rule_attrs.source,
+		.on_threshold = dev_ctx.rule_attrs.on_threshold,
+		.off_threshold = dev_ctx.rule_attrs.off_threshold,
+		.on_delay_s = dev_ctx.rule_attrs.on_delay_s,
+		.off_delay_s = dev_ctx.rule_attrs.off_delay_s,
+	};
+	int ret;
+
+	/* The written value may not be stored in the attribute yet */
+	switch (attr_id) {
+	case ENVIRONMENTAL_SENSOR_ATTR_RULE_SOURCE_ID:
+		rule.source = value->data8;
+		break;
+	case ENVIRONMENTAL_SENSOR_ATTR_RULE_ON_THRESHOLD_ID:
+		rule.on_threshold = (zb_int16_t)value->data16;
+		break;
+	case ENVIRONMENTAL_SENSOR_ATTR_RULE_OFF_THRESHOLD_ID:
+		rule.off_threshold = (zb_int16_t)value->data16;
+		break;
+	case ENVIRONMENTAL_SENSOR_ATTR_RULE_ON_DELAY_ID:
+		rule.on_delay_s = value->data16;
+		break;
+	case ENVIRONMENTAL_SENSOR_ATTR_RULE_OFF_DELAY_ID:
+		rule.off_delay_s = value->data16;
+		break;
+	default:
+		return;
+	}
+
+	ret = rule_svc_set_config(&rule);
+	if (ret == -EINVAL) {
+		LOG_INF("Rule attributes incomplete, keeping the active rule until they are valid");
+	} else if (ret != 0) {
+		LOG_ERR("Failed to apply the rule: %d", ret);
+	}
+}
+#endif
+
+static void zcl_device_cb(zb_bufid_t bufid)
+{
+	zb_zcl_device_callback_param_t *param =
+		ZB_BUF_GET_PARAM(bufid, zb_zcl_device_callback_param_t);
+
+	param->status = RET_OK;
+
+	switch (param->device_cb_id) {
+	case ZB_ZCL_SET_ATTR_VALUE_CB_ID:
+#if defined(CONFIG_THRESHOLD_RULES)
+		if (param->cb_param.set_attr_value_param.cluster_id ==
+		    ZB_ZCL_CLUSTER_ID_REL_HUMIDITY_MEASUREMENT) {
+			rule_attr_written(param->cb_param.set_attr_value_param.attr_id,
+					  &param->cb_param.set_attr_value_param.values);
+		}
+#endif
+		break;
+
+	default:
+		param->status = RET_NOT_IMPLEMENTED;
+		break;
 	}
 }
 
@@ -174,6 +619,7 @@ int zigbee_svc_schedule_fn(enum zigbee_function fn_id, uint16_t user_param)
 		break;
 
 	case ZIGBEE_WIPE_DATA:
+	case ZIGBEE_FACTORY_RESET:
 		ARG_UNUSED(user_param);
 		LOG_WRN("Performing factory reset . . .");
 		ret = ZB_SCHEDULE_APP_CALLBACK(zb_bdb_reset_via_local_action, 0);
@@ -182,12 +628,19 @@ int zigbee_svc_schedule_fn(enum zigbee_function fn_id, uint16_t user_param)
 				ret);
 		}
 		zigbee_erase_persistent_storage(true);
+		/* After a failed rejoin the device scans again right away, on the known channels */
+		if (IS_ENABLED(CONFIG_CHANNEL_HISTORY) && fn_id == ZIGBEE_FACTORY_RESET) {
+			channel_history_svc_clear();
+		}
+		/* The bound devices the rule drives are gone with the network data */
+		if (IS_ENABLED(CONFIG_THRESHOLD_RULES)) {
+			rule_svc_clear();
+		}
 		zigbee_data_wiped = true;
 		break;
 
 	case ZIGBEE_UPDATE_TEMPERATURE_ATTRIBUTE:
-		ret = ZB_SCHEDULE_APP_CALLBACK2(zigbee_svc_update_temperature_attribute, 0,
-						user_param);
+		ret = ZB_SCHEDULE_APP_CALLBACK2(update_temperature, 0, user_param);
 		if (ret) {
 			LOG_ERR("Failed to schedule zigbee_svc_update_zb_attributes function!: %d",
 				ret);
@@ -195,14 +648,27 @@ int zigbee_svc_schedule_fn(enum zigbee_function fn_id, uint16_t user_param)
 		break;
 
 	case ZIGBEE_UPDATE_HUMIDITY_ATTRIBUTE:
-		ret = ZB_SCHEDULE_APP_CALLBACK2(zigbee_svc_update_humidity_attribute, 0,
-						user_param);
+		ret = ZB_SCHEDULE_APP_CALLBACK2(update_humidity, 0, user_param);
 		if (ret) {
 			LOG_ERR("Failed to schedule zigbee_svc_update_zb_attributes function!: %d",
 				ret);
 		}
 		break;
 
+	case ZIGBEE_START_FAST_POLL:
+		ret = ZB_SCHEDULE_APP_CALLBACK2(start_fast_poll, 0, user_param);
+		if (ret) {
+			LOG_ERR("Failed to schedule start_fast_poll function!: %d", ret);
+		}
+		break;
+
+	case ZIGBEE_SEND_ON_OFF:
+		ret = ZB_SCHEDULE_APP_CALLBACK2(request_on_off, 0, user_param);
+		if (ret) {
+			LOG_ERR("Failed to schedule request_on_off function!: %d", ret);
+		}
+		break;
+
 	default:
 		break;
 	}
@@ -210,6 +676,74 @@ int zigbee_svc_schedule_fn(enum zigbee_function fn_id, uint16_t user_param)
 	return ret;
 }
 
+int zigbee_svc_update_measurements(int16_t temperature, uint16_t humidity, uint32_t sampled_cyc)
+{
+	k_spinlock_key_t key;
+	zb_ret_t ret;
+
+	/* A measurement not yet picked up by the stack is simply replaced */
+	key = k_spin_lock(&pending_measurement_lock);
+	pending_measurement.temperature = temperature;
+	pending_measurement.humidity = humidity;
+	pending_measurement.sampled_cyc = sampled_cyc;
+	k_spin_unlock(&pending_measurement_lock, key);
+
+	if (!IS_ENABLED(CONFIG_ZIGBEE_COALESCED_REPORTING)) {
+		ret = zigbee_svc_schedule_fn(ZIGBEE_UPDATE_TEMPERATURE_ATTRIBUTE, temperature);
+		if (ret == 0) {
+			ret = zigbee_svc_schedule_fn(ZIGBEE_UPDATE_HUMIDITY_ATTRIBUTE, humidity);
+		}
+		if (ret == 0) {
+			/* Callbacks run in order, this one after both attributes were updated */
+			ret = ZB_SCHEDULE_APP_CALLBACK(measurement_applied, 0);
+			if (ret) {
+				LOG_ERR("Failed to schedule measurement_applied function!: %d",
+					ret);
+			}
+		}
+	} else {
+		ret = ZB_SCHEDULE_APP_CALLBACK(update_measurements, 0);
+		if (ret) {
+			LOG_ERR("Failed to schedule update_measurements function!: %d", ret);
+		}
+	}
+
+	if (ret == 0) {
+		/* Piggyback on the measurement wake-up so reads never wait for the stack */
+		ret = ZB_SCHEDULE_APP_CALLBACK(diagnostics_refresh_mac_stats, 0);
+		if (ret) {
+			LOG_ERR("Failed to schedule diagnostics_refresh_mac_stats function!: %d",
+				ret);
+		}
+	}
+
+	return ret;
+}
+
+void zigbee_svc_get_reporting_stats(struct zigbee_reporting_stats *stats)
+{
+	struct report_window_stats window_stats;
+
+	report_window_get_stats(&window_stats);
+
+	*stats = reporting_stats;
+	stats->radio_windows = window_stats.radio_windows;
+	stats->reports = window_stats.reports;
+	stats->forced = window_stats.forced;
+}
+
+void zigbee_svc_log_reporting_stats(void)
+{
+	struct zigbee_reporting_stats s;
+
+	zigbee_svc_get_reporting_stats(&s);
+
+	LOG_INF("Sample to attribute latency: last %u us, max %u us", s.last_latency_us,
+		s.max_latency_us);
+	LOG_INF("Reporting: %u measurements, %u radio windows, %u reports (%u forced)",
+		s.measurements, s.radio_windows, s.reports, s.forced);
+}
+
 void zboss_signal_handler(zb_bufid_t bufid)
 {
 	int ret;
@@ -229,6 +763,17 @@ void zboss_signal_handler(zb_bufid_t bufid)
 		/* Call default signal handler. */
 		ZB_ERROR_CHECK(zigbee_default_signal_handler(bufid));
 
+		/* On first start the default handler has just started network steering */
+		if (IS_ENABLED(CONFIG_CHANNEL_HISTORY) &&
+		    signal != ZB_BDB_SIGNAL_DEVICE_FIRST_START) {
+			channel_history_svc_scan_finished(ZB_JOINED());
+		}
+
+		if (signal == ZB_BDB_SIGNAL_STEERING) {
+			ui_play_led_pattern(ZB_JOINED() ? UI_LED_PATTERN_JOINED
+							: UI_LED_PATTERN_ERROR);
+		}
+
 		if (ZB_JOINED()) {
 			joining_signal_received = true;
 
@@ -265,7 +810,12 @@ void zboss_signal_handler(zb_bufid_t bufid)
 			 */
 			if (leave_params->leave_type == ZB_NWK_LEAVE_TYPE_REJOIN) {
 				joining_signal_received = false;
+				diagnostics_counter_inc(&dev_ctx.diagnostics_attrs.rejoins);
+			} else {
+				/* The reporting rules are dropped with the network data */
+				report_window_reset();
 			}
+			parent_short_addr = ZB_UNKNOWN_SHORT_ADDR;
 
 			struct event evt;
 			evt.type = EVENT_NETWORK_NOT_CONNECTED;
@@ -285,9 +835,23 @@ void zboss_signal_handler(zb_bufid_t bufid)
 		zb_zdo_signal_nlme_status_indication_params_t *nlme_status_ind =
 			ZB_ZDO_SIGNAL_GET_PARAMS(signal_header,
 						 zb_zdo_signal_nlme_status_indication_params_t);
+		/* Other statuses report addressing and security events, not a broken link */
+		switch (nlme_status_ind->nlme_status.status) {
+		case ZB_NWK_COMMAND_STATUS_NO_ROUTE_AVAILABLE:
+		case ZB_NWK_COMMAND_STATUS_TREE_LINK_FAILURE:
+		case ZB_NWK_COMMAND_STATUS_NONE_TREE_LINK_FAILURE:
+		case ZB_NWK_COMMAND_STATUS_PARENT_LINK_FAILURE:
+			diagnostics_counter_inc(&dev_ctx.diagnostics_attrs.link_failures);
+			break;
+		default:
+			break;
+		}
+
 		if (nlme_status_ind->nlme_status.status ==
 		    ZB_NWK_COMMAND_STATUS_PARENT_LINK_FAILURE) {
 			LOG_WRN("Parent link failure detected.");
+			/* Raised by the stack once polls to the parent keep failing */
+			diagnostics_counter_inc(&dev_ctx.diagnostics_attrs.poll_failures);
 
 			/* Check for a broken rejoin procedure and restart the device to recover. */
 			if (!joining_signal_received) {
@@ -297,6 +861,7 @@ void zboss_signal_handler(zb_bufid_t bufid)
 					LOG_ERR("Failed to wipe zigbee data!");
 				}
 			} else {
+				diagnostics_counter_inc(&dev_ctx.diagnostics_attrs.rejoins);
 				ret = ZB_SCHEDULE_APP_CALLBACK(start_joining, 0);
 				if (ret) {
 					LOG_ERR("Failed to schedule start_joining function!: %d",
@@ -323,28 +888,64 @@ void zboss_signal_handler(zb_bufid_t bufid)
 
 void zigbee_svc_start(void)
 {
+#if defined(CONFIG_ZIGBEE_ROLE_END_DEVICE)
 	/* Enable Sleepy End Device behavior */
 	zb_set_rx_on_when_idle(ZB_FALSE);
+#endif
 	if (IS_ENABLED(CONFIG_RAM_POWER_DOWN_LIBRARY)) {
 		power_down_unused_ram();
 	}
+	boot_profile_mark(BOOT_MILESTONE_RAM_POWER_DOWN);
 
+#if defined(CONFIG_ZIGBEE_ROLE_END_DEVICE)
 	zb_set_ed_timeout(CONFIG_NWK_ED_DEVICE_TIMEOUT_INDEX);
 	zb_set_keepalive_timeout(ZB_MILLISECONDS_TO_BEACON_INTERVAL(KEEP_ALIVE_PERIOD_MSEC));
+#endif
+
+	if (IS_ENABLED(CONFIG_CHANNEL_HISTORY)) {
+		/* Rejoin or network steering starts as soon as the stack is enabled */
+		channel_history_svc_scan_started();
+	}
 
 	/* Start Zigbee stack */
 	zigbee_enable();
+	boot_profile_mark(BOOT_MILESTONE_ZB_ENABLED);
 
-	LOG_INF("Zigbee environmental sensor started");
+	LOG_INF("Zigbee environmental sensor started as %s",
+		IS_ENABLED(CONFIG_ZIGBEE_ROLE_END_DEVICE) ? "sleepy end device" : "router");
 }
 
 void zigbee_svc_init(void)
 {
 	/* Register device context (endpoint) */
 	ZB_AF_REGISTER_DEVICE_CTX(&environmental_sensor_ctx);
+	boot_profile_mark(BOOT_MILESTONE_ZB_CTX_REGISTERED);
+
+	/* Track LQI, RSSI and parent changes from received frames */
+	zb_af_set_data_indication(data_indication_cb);
+
+	/* Attribute writes from the network */
+	ZB_ZCL_REGISTER_DEVICE_CB(zcl_device_cb);
 
 	/* Init Basic and Identify and measurements-related attributes */
 	zigbee_svc_clusters_init();
 	zigbee_svc_update_humidity_attribute(0, 0);
 	zigbee_svc_update_temperature_attribute(0, 0);
+	boot_profile_mark(BOOT_MILESTONE_ZB_CLUSTERS_INIT);
+
+	if (IS_ENABLED(CONFIG_CHANNEL_HISTORY)) {
+		if (channel_history_svc_init() != 0) {
+			LOG_ERR("Failed to restore channel history, scanning all channels");
+		}
+	}
+
+#if defined(CONFIG_THRESHOLD_RULES)
+	struct threshold_rule rule;
+
+	if (rule_svc_init() != 0) {
+		LOG_ERR("Failed to restore threshold rule");
+	}
+	rule_svc_get_config(&rule);
+	rule_attrs_from_config(&rule);
+#endif
 }
@@ -7,13 +7,32 @@
 #ifndef APP_ZIGBEE_SVC_H
 #define APP_ZIGBEE_SVC_H
 
+#include <stdint.h>
+
 #include "zb_environmental_sensor.h"
 
+struct zigbee_reporting_stats {
+	/* Measurements published to the ZCL attributes */
+	uint32_t measurements;
+	/* Radio windows opened by at least one due report */
+	uint32_t radio_windows;
+	/* Reports sent in these windows */
+	uint32_t reports;
+	/* Reports sent ahead of their maximum interval to share a window */
+	uint32_t forced;
+	/* Time from the sample to its values in the attributes, due reports are built from there */
+	uint32_t last_latency_us;
+	uint32_t max_latency_us;
+};
+
 enum zigbee_function {
 	ZIGBEE_START_JOINING,
 	ZIGBEE_WIPE_DATA,
+	ZIGBEE_FACTORY_RESET,
 	ZIGBEE_UPDATE_TEMPERATURE_ATTRIBUTE,
 	ZIGBEE_UPDATE_HUMIDITY_ATTRIBUTE,
+	ZIGBEE_START_FAST_POLL,
+	ZIGBEE_SEND_ON_OFF,
 };
 
 /**
@@ -21,10 +40,16 @@ enum zigbee_function {
  *
  * @param[in] fn_id The Zigbee function to execute:
  *                  - ZIGBEE_START_JOINING: Start Zigbee network joining.
- *                  - ZIGBEE_WIPE_DATA: Factory reset and wipe Zigbee data.
+ *                  - ZIGBEE_WIPE_DATA: Wipe Zigbee data to recover from a failed rejoin,
+ *                    the learned network channels are kept for the next scan.
+ *                  - ZIGBEE_FACTORY_RESET: Wipe Zigbee data on user request, the learned
+ *                    network channels are forgotten as well.
  *                  - ZIGBEE_UPDATE_TEMPERATURE_ATTRIBUTE: Update temperature attribute.
  *                  - ZIGBEE_UPDATE_HUMIDITY_ATTRIBUTE: Update humidity attribute.
- * @param[in] user_param Data associated with the function (scaled sensor values for updates).
+ *                  - ZIGBEE_START_FAST_POLL: Poll the parent continuously for a while.
+ *                  - ZIGBEE_SEND_ON_OFF: Send On or Off to the bound devices.
+ * @param[in] user_param Data associated with the function (scaled sensor values for updates,
+ *                       window length in seconds for fast poll, 1 for On and 0 for Off).
  *
  * @return 0 on success, negative error code on failure.
  *
@@ -32,11 +57,41 @@ enum zigbee_function {
  */
 int zigbee_svc_schedule_fn(enum zigbee_function fn_id, uint16_t user_param);
 
+/**
+ * @brief Publish a new measurement to the temperature and humidity attributes.
+ *
+ * @details With CONFIG_ZIGBEE_COALESCED_REPORTING both attributes are updated in one ZBOSS
+ *          callback. Reports due then leave together with the periodic reports that would
+ *          otherwise need the next wake-up, and the post-transmit turbo poll ends once they
+ *          are sent. Otherwise each attribute is updated on its own.
+ *
+ * @param[in] temperature Temperature in ZCL units (0.01 °C).
+ * @param[in] humidity Relative humidity in ZCL units (0.01 %).
+ * @param[in] sampled_cyc k_cycle_get_32() when the values were sampled, for the latency
+ *                        counters.
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+int zigbee_svc_update_measurements(int16_t temperature, uint16_t humidity, uint32_t sampled_cyc);
+
+/**
+ * @brief Get the attribute reporting counters.
+ *
+ * @param[out] stats Counters since boot.
+ */
+void zigbee_svc_get_reporting_stats(struct zigbee_reporting_stats *stats);
+
+/**
+ * @brief Log the sample to attribute latency and the reporting counters.
+ */
+void zigbee_svc_log_reporting_stats(void);
+
 /**
  * @brief Starts the Zigbee service.
  *
- * @details Function configures the Zigbee device as a Sleepy End Device (SED),
- *          powers down unused RAM if configured, and enables the Zigbee stack.
+ * @details Function configures the Zigbee device as a Sleepy End Device (SED) unless it is
+ *          built as a router, powers down unused RAM if configured, and enables the Zigbee
+ *          stack.
  */
 void zigbee_svc_start(void);
 
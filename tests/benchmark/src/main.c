@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/timing/timing.h>
+#include <zephyr/ztest.h>
+
+#include <zboss_api.h>
+
+#include "humidity_temperature_svc.h"
+#include "zb_environmental_sensor.h"
+
+#define ITERATIONS CONFIG_BENCHMARK_ITERATIONS
+
+#define TEMPERATURE_MULTIPLIER ZCL_TEMPERATURE_MEASUREMENT_MEASURED_VALUE_MULTIPLIER
+#define HUMIDITY_MULTIPLIER    ZCL_HUMIDITY_MEASUREMENT_MEASURED_VALUE_MULTIPLIER
+
+struct bench_result {
+	uint64_t min;
+	uint64_t max;
+	uint64_t total;
+	uint32_t iterations;
+};
+
+/*
+ * Attribute table of the stack as far as zb_zcl_set_attr_val() goes: look the attribute up,
+ * skip an unchanged value, store it and mark it for reporting.
+ */
+struct attr_stub {
+	zb_uint16_t cluster_id;
+	zb_uint16_t attr_id;
+	void *data;
+	size_t size;
+	bool report;
+};
+
+static zb_int16_t temperature_attr;
+static zb_uint16_t humidity_attr;
+
+static struct attr_stub attrs[] = {
+	{ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT, ZB_ZCL_ATTR_TEMP_MEASUREMENT_VALUE_ID,
+	 &temperature_attr, sizeof(temperature_attr)},
+	{ZB_ZCL_CLUSTER_ID_REL_HUMIDITY_MEASUREMENT, ZB_ZCL_ATTR_REL_HUMIDITY_MEASUREMENT_VALUE_ID,
+	 &humidity_attr, sizeof(humidity_attr)},
+};
+
+/* Keeps the compiler from folding the measured expressions */
+static volatile float sink_f;
+static volatile int32_t sink_i;
+
+zb_zcl_status_t zb_zcl_set_attr_val(zb_uint8_t ep, zb_uint16_t cluster_id, zb_uint8_t cluster_role,
+				    zb_uint16_t attr_id, zb_uint8_t *value, zb_bool_t check_access)
+{
+	ARG_UNUSED(check_access);
+
+	if (ep != ENVIRONMENTAL_SENSOR_ENDPOINT_NB || cluster_role != ZB_ZCL_CLUSTER_SERVER_ROLE) {
+		return ZB_ZCL_STATUS_UNSUP_ATTRIB;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(attrs); i++) {
+		if (attrs[i].cluster_id != cluster_id || attrs[i].attr_id != attr_id) {
+			continue;
+		}
+
+		if (memcmp(attrs[i].data, value, attrs[i].size) != 0) {
+			memcpy(attrs[i].data, value, attrs[i].size);
+			attrs[i].report = true;
+		}
+
+		return ZB_ZCL_STATUS_SUCCESS;
+	}
+
+	return ZB_ZCL_STATUS_UNSUP_ATTRIB;
+}
+
+static void bench_add(struct bench_result *res, timing_t start, timing_t end)
+{
+	uint64_t cycles = timing_cycles_get(&start, &end);
+
+	res->min = (res->iterations == 0) ? cycles : MIN(res->min, cycles);
+	res->max = MAX(res->max, cycles);
+	res->total += cycles;
+	res->iterations++;
+}
+
+static void bench_report(const char *name, const struct bench_result *res)
+{
+	uint64_t avg;
+
+	zassert_equal(res->iterations, ITERATIONS);
+	avg = res->total / res->iterations;
+	zassert_true(res->min <= avg && avg <= res->max);
+
+	TC_PRINT("bench,%s,%u,%llu,%llu,%llu,%llu\n", name, res->iterations, res->min, avg,
+		 res->max, timing_cycles_to_ns(avg));
+}
+
+static void *benchmark_setup(void)
+{
+	zassert_ok(humidity_temperature_svc_init());
+
+	timing_init();
+	timing_start();
+
+	TC_PRINT("bench,name,iterations,min_cycles,avg_cycles,max_cycles,avg_ns\n");
+
+	return NULL;
+}
+
+static void benchmark_teardown(void *f)
+{
+	ARG_UNUSED(f);
+
+	timing_stop();
+}
+
+static void benchmark_before(void *f)
+{
+	ARG_UNUSED(f);
+
+	/* The channel getters convert the last fetched sample */
+	zassert_ok(humidity_temperature_svc_trigger_measurement());
+}
+
+ZTEST_SUITE(benchmark, NULL, benchmark_setup, benchmark_before, NULL, benchmark_teardown);
+
+ZTEST(benchmark, test_get_temperature)
+{
+	struct bench_result res = {0};
+	timing_t start;
+	timing_t end;
+
+	for (int i = 0; i < ITERATIONS; i++) {
+		start = timing_counter_get();
+		sink_f = humidity_temperature_svc_get_temperature();
+		end = timing_counter_get();
+		bench_add(&res, start, end);
+	}
+
+	bench_report("get_temperature", &res);
+}
+
+ZTEST(benchmark, test_get_humidity)
+{
+	struct bench_result res = {0};
+	timing_t start;
+	timing_t end;
+
+	for (int i = 0; i < ITERATIONS; i++) {
+		start = timing_counter_get();
+		sink_f = humidity_temperature_svc_get_humidity();
+		end = timing_counter_get();
+		bench_add(&res, start, end);
+	}
+
+	bench_report("get_humidity", &res);
+}
+
+/* Same conversion as publish_measurements() in main.c */
+ZTEST(benchmark, test_value_scaling)
+{
+	volatile float temperature = 21.37f;
+	volatile float humidity = 45.6f;
+	struct bench_result res = {0};
+	timing_t start;
+	timing_t end;
+
+	for (int i = 0; i < ITERATIONS; i++) {
+		start = timing_counter_get();
+		sink_i = (int16_t)(temperature * TEMPERATURE_MULTIPLIER);
+		sink_i = (uint16_t)(humidity * HUMIDITY_MULTIPLIER);
+		end = timing_counter_get();
+		bench_add(&res, start, end);
+	}
+
+	bench_report("value_scaling", &res);
+}
+
+/* Same call as the temperature update of zigbee_svc.c */
+ZTEST(benchmark, test_set_attr_val)
+{
+	struct bench_result res = {0};
+	zb_int16_t value;
+	timing_t start;
+	timing_t end;
+
+	for (int i = 0; i < ITERATIONS; i++) {
+		/* A different value every time, so the value is stored and marked for reporting */
+		value = temperature_attr + 1;
+		start = timing_counter_get();
+		sink_i = zb_zcl_set_attr_val(ENVIRONMENTAL_SENSOR_ENDPOINT_NB,
+					     ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT,
+					     ZB_ZCL_CLUSTER_SERVER_ROLE,
+					     ZB_ZCL_ATTR_TEMP_MEASUREMENT_VALUE_ID,
+					     (zb_uint8_t *)&value, ZB_FALSE);
+		end = timing_counter_get();
+		bench_add(&res, start, end);
+		zassert_equal(sink_i, ZB_ZCL_STATUS_SUCCESS);
+	}
+
+	zassert_equal(temperature_attr, ITERATIONS);
+	zassert_true(attrs[0].report);
+
+	bench_report("zb_zcl_set_attr_val", &res);
+}
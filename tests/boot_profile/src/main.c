@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#include "boot_profile.h"
+
+/* Every test marks milestones of its own, the profile keeps the first mark until reset */
+
+ZTEST_SUITE(boot_profile, NULL, NULL, NULL, NULL, NULL);
+
+ZTEST(boot_profile, test_kernel_marked_at_init)
+{
+	uint64_t kernel_us = boot_profile_get_us(BOOT_MILESTONE_KERNEL);
+
+	/* Recorded by the POST_KERNEL hook, before the test thread ran */
+	zassert_not_equal(kernel_us, 0);
+	zassert_true(kernel_us <= k_ticks_to_us_floor64(k_uptime_ticks()));
+}
+
+ZTEST(boot_profile, test_first_mark_kept)
+{
+	uint64_t first_us;
+
+	zassert_equal(boot_profile_get_us(BOOT_MILESTONE_MAIN), 0);
+
+	boot_profile_mark(BOOT_MILESTONE_MAIN);
+	first_us = boot_profile_get_us(BOOT_MILESTONE_MAIN);
+	zassert_not_equal(first_us, 0);
+
+	k_sleep(K_MSEC(10));
+	boot_profile_mark(BOOT_MILESTONE_MAIN);
+	zassert_equal(boot_profile_get_us(BOOT_MILESTONE_MAIN), first_us);
+}
+
+ZTEST(boot_profile, test_milestones_follow_uptime)
+{
+	uint64_t power_us;
+	uint64_t sensor_us;
+
+	boot_profile_mark(BOOT_MILESTONE_POWER_INIT);
+	k_sleep(K_MSEC(10));
+	boot_profile_mark(BOOT_MILESTONE_SENSOR_INIT);
+
+	power_us = boot_profile_get_us(BOOT_MILESTONE_POWER_INIT);
+	sensor_us = boot_profile_get_us(BOOT_MILESTONE_SENSOR_INIT);
+	zassert_true(sensor_us - power_us >= 10 * USEC_PER_MSEC, "%llu us apart",
+		     sensor_us - power_us);
+}
+
+ZTEST(boot_profile, test_unreached_milestones_skipped)
+{
+	zassert_equal(boot_profile_get_us(BOOT_MILESTONE_ZB_ENABLED), 0);
+
+	/* Marking the first report logs the timeline without the milestones not reached */
+	boot_profile_mark(BOOT_MILESTONE_FIRST_REPORT_QUEUED);
+	zassert_not_equal(boot_profile_get_us(BOOT_MILESTONE_FIRST_REPORT_QUEUED), 0);
+	zassert_equal(boot_profile_get_us(BOOT_MILESTONE_ZB_ENABLED), 0);
+}
+
+ZTEST(boot_profile, test_unknown_milestone_ignored)
+{
+	boot_profile_mark(BOOT_MILESTONE_COUNT);
+
+	zassert_equal(boot_profile_get_us(BOOT_MILESTONE_COUNT), 0);
+}
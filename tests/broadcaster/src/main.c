@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/ztest.h>
+
+#include "ble_svc.h"
+#include "bthome.h"
+#include "fake_sht4x.h"
+#include "humidity_temperature_svc.h"
+
+#define ADV_EVENTS       CONFIG_BTHOME_ADV_EVENTS
+#define HEARTBEAT_PERIOD K_SECONDS(CONFIG_BTHOME_HEARTBEAT_PERIOD_SECONDS)
+
+/* Measurements in 0.001 units, exact in the float the service converts them to */
+#define BASE_TEMPERATURE_STEP 1000
+#define SMALL_TEMPERATURE     62
+#define LARGE_TEMPERATURE     250
+#define BASE_HUMIDITY         45000
+#define SMALL_HUMIDITY        500
+#define LARGE_HUMIDITY        2000
+
+/* Service data index of the advertising data built by ble_svc.c, after the flags */
+#define AD_SERVICE_DATA 1
+
+/* The advertising set as the controller sees it */
+static const struct bt_le_ext_adv_cb *adv_callbacks;
+static uint8_t adv_set;
+static uint8_t adv_data[BTHOME_SERVICE_DATA_LEN];
+static bool adv_running;
+static uint16_t adv_num_events;
+static uint32_t adv_starts;
+static uint32_t adv_stops;
+
+static int32_t temperature_mc;
+static int32_t humidity_mpct;
+
+int bt_enable(bt_ready_cb_t cb)
+{
+	ARG_UNUSED(cb);
+
+	return 0;
+}
+
+int bt_le_ext_adv_create(const struct bt_le_adv_param *param, const struct bt_le_ext_adv_cb *cb,
+			 struct bt_le_ext_adv **adv)
+{
+	ARG_UNUSED(param);
+
+	adv_callbacks = cb;
+	*adv = (struct bt_le_ext_adv *)&adv_set;
+
+	return 0;
+}
+
+int bt_le_ext_adv_set_data(struct bt_le_ext_adv *adv, const struct bt_data *ad, size_t ad_len,
+			   const struct bt_data *sd, size_t sd_len)
+{
+	ARG_UNUSED(adv);
+	ARG_UNUSED(sd);
+	ARG_UNUSED(sd_len);
+
+	zassert_true(ad_len > AD_SERVICE_DATA);
+	zassert_equal(ad[AD_SERVICE_DATA].data_len, sizeof(adv_data));
+	memcpy(adv_data, ad[AD_SERVICE_DATA].data, sizeof(adv_data));
+
+	return 0;
+}
+
+int bt_le_ext_adv_start(struct bt_le_ext_adv *adv, const struct bt_le_ext_adv_start_param *param)
+{
+	ARG_UNUSED(adv);
+
+	zassert_false(adv_running, "Burst started while another one is running");
+	adv_running = true;
+	adv_num_events = param->num_events;
+	adv_starts++;
+
+	return 0;
+}
+
+int bt_le_ext_adv_stop(struct bt_le_ext_adv *adv)
+{
+	ARG_UNUSED(adv);
+
+	adv_running = false;
+	adv_stops++;
+
+	return 0;
+}
+
+/* The controller sent all events of the burst */
+static void complete_burst(void)
+{
+	struct bt_le_ext_adv_sent_info info = {
+		.num_sent = adv_num_events,
+	};
+
+	zassert_true(adv_running, "No burst running");
+	adv_running = false;
+	adv_callbacks->sent((struct bt_le_ext_adv *)&adv_set, &info);
+
+	/* Let a burst waiting for this one start */
+	k_sleep(K_MSEC(1));
+}
+
+static void set_sensor_value(struct sensor_value *val, int32_t milli)
+{
+	val->val1 = milli / 1000;
+	val->val2 = (milli % 1000) * 1000;
+}
+
+/* Sample and publish like main.c does */
+static void measure_and_publish(int32_t temperature, int32_t humidity)
+{
+	temperature_mc = temperature;
+	humidity_mpct = humidity;
+	set_sensor_value(&fake_sht4x.temperature, temperature);
+	set_sensor_value(&fake_sht4x.humidity, humidity);
+	zassert_ok(humidity_temperature_svc_trigger_measurement());
+
+	zassert_ok(ble_svc_update_measurements(
+		humidity_temperature_svc_get_temperature() * BTHOME_TEMPERATURE_MULTIPLIER,
+		humidity_temperature_svc_get_humidity() * BTHOME_HUMIDITY_MULTIPLIER));
+
+	/* The burst is started from the system workqueue */
+	k_sleep(K_MSEC(1));
+}
+
+static void assert_advertised(int32_t temperature, int32_t humidity)
+{
+	uint8_t expected[BTHOME_SERVICE_DATA_LEN];
+
+	zassert_equal(bthome_encode(expected, sizeof(expected), temperature / 10, humidity / 10),
+		      sizeof(expected));
+	zassert_mem_equal(adv_data, expected, sizeof(expected));
+}
+
+static void *broadcaster_setup(void)
+{
+	zassert_ok(humidity_temperature_svc_init());
+	zassert_ok(ble_svc_init());
+
+	return NULL;
+}
+
+static void broadcaster_before(void *f)
+{
+	static int32_t base_temperature = 20000;
+
+	ARG_UNUSED(f);
+
+	if (adv_running) {
+		complete_burst();
+	}
+
+	/* A changed baseline is advertised, the heartbeat period starts over */
+	base_temperature += BASE_TEMPERATURE_STEP;
+	measure_and_publish(base_temperature, BASE_HUMIDITY);
+	complete_burst();
+	adv_starts = 0;
+	adv_stops = 0;
+}
+
+ZTEST_SUITE(broadcaster, NULL, broadcaster_setup, broadcaster_before, NULL, NULL);
+
+ZTEST(broadcaster, test_change_advertised)
+{
+	int32_t temperature = temperature_mc + LARGE_TEMPERATURE;
+
+	measure_and_publish(temperature, humidity_mpct);
+	zassert_equal(adv_starts, 1);
+	zassert_equal(adv_num_events, ADV_EVENTS);
+	assert_advertised(temperature, humidity_mpct);
+	complete_burst();
+
+	measure_and_publish(temperature_mc, humidity_mpct + LARGE_HUMIDITY);
+	zassert_equal(adv_starts, 2);
+	assert_advertised(temperature_mc, humidity_mpct);
+}
+
+ZTEST(broadcaster, test_small_change_skipped)
+{
+	struct ble_svc_stats before;
+	struct ble_svc_stats after;
+
+	ble_svc_get_stats(&before);
+	measure_and_publish(temperature_mc + SMALL_TEMPERATURE, humidity_mpct + SMALL_HUMIDITY);
+	ble_svc_get_stats(&after);
+
+	zassert_equal(adv_starts, 0);
+	zassert_equal(after.skipped, before.skipped + 1);
+	zassert_equal(after.bursts, before.bursts);
+}
+
+ZTEST(broadcaster, test_heartbeat)
+{
+	int32_t temperature = temperature_mc + SMALL_TEMPERATURE;
+
+	k_sleep(HEARTBEAT_PERIOD);
+
+	/* The values are sent again although they did not change enough */
+	measure_and_publish(temperature, humidity_mpct);
+	zassert_equal(adv_starts, 1);
+	assert_advertised(temperature, humidity_mpct);
+}
+
+ZTEST(broadcaster, test_burst_not_cut_short)
+{
+	struct ble_svc_stats before;
+	struct ble_svc_stats after;
+	int32_t first = temperature_mc + LARGE_TEMPERATURE;
+	int32_t second = first + LARGE_TEMPERATURE;
+
+	ble_svc_get_stats(&before);
+	measure_and_publish(first, humidity_mpct);
+	measure_and_publish(second, humidity_mpct);
+
+	/* The second update waits for the first burst */
+	zassert_equal(adv_starts, 1);
+	assert_advertised(first, humidity_mpct);
+
+	complete_burst();
+	zassert_equal(adv_starts, 2);
+	assert_advertised(second, humidity_mpct);
+	complete_burst();
+
+	ble_svc_get_stats(&after);
+	zassert_equal(adv_stops, 0);
+	zassert_equal(after.bursts, before.bursts + 2);
+	zassert_equal(after.adv_events, before.adv_events + 2 * ADV_EVENTS);
+}
+
+ZTEST(broadcaster, test_advertise_now)
+{
+	zassert_ok(ble_svc_advertise_now());
+	k_sleep(K_MSEC(1));
+
+	zassert_equal(adv_starts, 1);
+	assert_advertised(temperature_mc, humidity_mpct);
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+
+#include <zephyr/ztest.h>
+
+#include "bthome.h"
+
+ZTEST_SUITE(bthome, NULL, NULL, NULL, NULL, NULL);
+
+ZTEST(bthome, test_encode_payload)
+{
+	/* 23.45 °C and 56.78 %, both little-endian */
+	static const uint8_t expected[] = {
+		0xD2, 0xFC, 0x44, 0x02, 0x29, 0x09, 0x03, 0x2E, 0x16,
+	};
+	uint8_t buf[BTHOME_SERVICE_DATA_LEN];
+
+	zassert_equal(bthome_encode(buf, sizeof(buf), 2345, 5678), sizeof(expected));
+	zassert_mem_equal(buf, expected, sizeof(expected));
+}
+
+ZTEST(bthome, test_encode_negative_temperature)
+{
+	uint8_t buf[BTHOME_SERVICE_DATA_LEN];
+
+	/* -12.34 °C is sent as a two's complement sint16 */
+	zassert_equal(bthome_encode(buf, sizeof(buf), -1234, 0), BTHOME_SERVICE_DATA_LEN);
+	zassert_equal(buf[4], 0x2E);
+	zassert_equal(buf[5], 0xFB);
+	zassert_equal(buf[7], 0x00);
+	zassert_equal(buf[8], 0x00);
+}
+
+ZTEST(bthome, test_encode_limits)
+{
+	uint8_t buf[BTHOME_SERVICE_DATA_LEN];
+
+	zassert_equal(bthome_encode(buf, sizeof(buf), INT16_MIN, 10000), BTHOME_SERVICE_DATA_LEN);
+	zassert_equal(buf[4], 0x00);
+	zassert_equal(buf[5], 0x80);
+	zassert_equal(buf[7], 0x10);
+	zassert_equal(buf[8], 0x27);
+}
+
+ZTEST(bthome, test_encode_buffer_too_small)
+{
+	uint8_t buf[BTHOME_SERVICE_DATA_LEN] = {0};
+
+	zassert_equal(bthome_encode(buf, sizeof(buf) - 1, 2345, 5678), -ENOBUFS);
+	zassert_equal(buf[0], 0, "Nothing may be written to a short buffer");
+}
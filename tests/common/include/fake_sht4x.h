@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef TESTS_FAKE_SHT4X_H
+#define TESTS_FAKE_SHT4X_H
+
+#include <stdint.h>
+
+#include <zephyr/drivers/sensor.h>
+
+struct fake_sht4x {
+	/* Values latched by the next fetch, 21.5 °C and 45.25 % until changed */
+	struct sensor_value temperature;
+	struct sensor_value humidity;
+	/* Duration of a conversion, the fetch sleeps that long */
+	uint32_t conversion_ms;
+	/* Error returned by the fetch, 0 to succeed */
+	int fetch_error;
+	/* Successful fetches */
+	uint32_t fetches;
+};
+
+extern struct fake_sht4x fake_sht4x;
+
+#endif /* TESTS_FAKE_SHT4X_H */
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Minimal ZBOSS types so application headers build on native_sim without the Zigbee stack */
+
+#ifndef TESTS_ZBOSS_API_STUB_H
+#define TESTS_ZBOSS_API_STUB_H
+
+#include <stdint.h>
+
+typedef uint8_t zb_uint8_t;
+typedef int8_t zb_int8_t;
+typedef uint16_t zb_uint16_t;
+typedef int16_t zb_int16_t;
+typedef uint32_t zb_uint32_t;
+typedef int32_t zb_int32_t;
+typedef unsigned int zb_uint_t;
+typedef uint8_t zb_bool_t;
+typedef uint8_t zb_bufid_t;
+typedef int32_t zb_ret_t;
+typedef char zb_char_t;
+
+#define ZB_TRUE  1
+#define ZB_FALSE 0
+
+#define RET_OK    0
+#define RET_ERROR (-1)
+
+#define ZVUNUSED(v) ((void)(v))
+
+/* ZCL attribute access, the test provides zb_zcl_set_attr_val() */
+typedef zb_uint8_t zb_zcl_status_t;
+
+#define ZB_ZCL_STATUS_SUCCESS      0x00
+#define ZB_ZCL_STATUS_UNSUP_ATTRIB 0x86
+
+#define ZB_ZCL_CLUSTER_SERVER_ROLE 0x01
+
+#define ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT         0x0402
+#define ZB_ZCL_CLUSTER_ID_REL_HUMIDITY_MEASUREMENT 0x0405
+
+#define ZB_ZCL_ATTR_TEMP_MEASUREMENT_VALUE_ID         0x0000
+#define ZB_ZCL_ATTR_REL_HUMIDITY_MEASUREMENT_VALUE_ID 0x0000
+
+zb_zcl_status_t zb_zcl_set_attr_val(zb_uint8_t ep, zb_uint16_t cluster_id, zb_uint8_t cluster_role,
+				    zb_uint16_t attr_id, zb_uint8_t *value, zb_bool_t check_access);
+
+#endif /* TESTS_ZBOSS_API_STUB_H */
@@ -0,0 +1,17 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef TESTS_ZB_ZCL_BASIC_ADDONS_STUB_H
+#define TESTS_ZB_ZCL_BASIC_ADDONS_STUB_H
+
+#include <zboss_api.h>
+
+typedef struct {
+	zb_uint8_t zcl_version;
+	zb_uint8_t power_source;
+} zb_zcl_basic_attrs_ext_t;
+
+#endif /* TESTS_ZB_ZCL_BASIC_ADDONS_STUB_H */
@@ -0,0 +1,19 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef TESTS_ZB_ZCL_TEMP_MEASUREMENT_ADDONS_STUB_H
+#define TESTS_ZB_ZCL_TEMP_MEASUREMENT_ADDONS_STUB_H
+
+#include <zboss_api.h>
+
+typedef struct {
+	zb_int16_t measure_value;
+	zb_int16_t min_measure_value;
+	zb_int16_t max_measure_value;
+	zb_uint16_t tolerance;
+} zb_zcl_temp_measurement_attrs_t;
+
+#endif /* TESTS_ZB_ZCL_TEMP_MEASUREMENT_ADDONS_STUB_H */
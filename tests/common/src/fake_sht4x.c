@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define DT_DRV_COMPAT sensirion_sht4x
+
+#include <errno.h>
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/sensor.h>
+#include <zephyr/kernel.h>
+
+#include "fake_sht4x.h"
+
+#define DEFAULT_TEMPERATURE {.val1 = 21, .val2 = 500000}
+#define DEFAULT_HUMIDITY    {.val1 = 45, .val2 = 250000}
+
+struct fake_sht4x fake_sht4x = {
+	.temperature = DEFAULT_TEMPERATURE,
+	.humidity = DEFAULT_HUMIDITY,
+};
+
+/* Like the SHT4x, channel reads return the values of the last successful fetch */
+static struct sensor_value fetched_temperature = DEFAULT_TEMPERATURE;
+static struct sensor_value fetched_humidity = DEFAULT_HUMIDITY;
+
+static int fake_sht4x_sample_fetch(const struct device *dev, enum sensor_channel chan)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(chan);
+
+	k_sleep(K_MSEC(fake_sht4x.conversion_ms));
+	if (fake_sht4x.fetch_error != 0) {
+		return fake_sht4x.fetch_error;
+	}
+
+	fetched_temperature = fake_sht4x.temperature;
+	fetched_humidity = fake_sht4x.humidity;
+	fake_sht4x.fetches++;
+
+	return 0;
+}
+
+static int fake_sht4x_channel_get(const struct device *dev, enum sensor_channel chan,
+				  struct sensor_value *val)
+{
+	ARG_UNUSED(dev);
+
+	switch (chan) {
+	case SENSOR_CHAN_AMBIENT_TEMP:
+		*val = fetched_temperature;
+		return 0;
+	case SENSOR_CHAN_HUMIDITY:
+		*val = fetched_humidity;
+		return 0;
+	default:
+		return -ENOTSUP;
+	}
+}
+
+static const struct sensor_driver_api fake_sht4x_api = {
+	.sample_fetch = fake_sht4x_sample_fetch,
+	.channel_get = fake_sht4x_channel_get,
+};
+
+DEVICE_DT_INST_DEFINE(0, NULL, NULL, NULL, NULL, POST_KERNEL, CONFIG_SENSOR_INIT_PRIORITY,
+		      &fake_sht4x_api);
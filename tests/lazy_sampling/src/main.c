@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#include "fake_sht4x.h"
+#include "humidity_temperature_svc.h"
+#include "lazy_sampling.h"
+
+#define MAX_AGE_MSEC          (1000 * CONFIG_LAZY_SAMPLING_MAX_AGE_SECONDS)
+#define MEASURING_PERIOD_MSEC (1000 * CONFIG_MEASURING_PERIOD_SECONDS)
+/* SHT4x high repeatability conversion time */
+#define CONVERSION_MS         9
+
+#define ZCL_MEASURED_VALUE_ID 0x0000
+#define ZCL_TOLERANCE_ID      0x0003
+
+#define BUSY_STACK_SIZE 1024
+
+static int publishes;
+static float published_temperature;
+
+static K_THREAD_STACK_DEFINE(busy_stack, BUSY_STACK_SIZE);
+static struct k_thread busy_thread;
+
+static void publish(void)
+{
+	published_temperature = humidity_temperature_svc_get_temperature();
+	publishes++;
+}
+
+static void make_sample_stale(void)
+{
+	uint32_t age_ms = humidity_temperature_svc_get_sample_age_ms();
+
+	if (age_ms <= MAX_AGE_MSEC) {
+		k_sleep(K_MSEC(MAX_AGE_MSEC - age_ms + 1));
+	}
+}
+
+static void lazy_sampling_before(void *f)
+{
+	ARG_UNUSED(f);
+
+	fake_sht4x.conversion_ms = CONVERSION_MS;
+	fake_sht4x.fetch_error = 0;
+	publishes = 0;
+	published_temperature = 0.0f;
+}
+
+ZTEST_SUITE(lazy_sampling, NULL, NULL, lazy_sampling_before, NULL, NULL);
+
+ZTEST(lazy_sampling, test_read_frame_parsing)
+{
+	/* Frame control, sequence number, command and attribute IDs */
+	static const uint8_t read_value[] = {0x00, 0x01, 0x00, 0x03, 0x00, 0x00, 0x00};
+	static const uint8_t read_tolerance[] = {0x00, 0x02, 0x00, 0x03, 0x00};
+	static const uint8_t write_value[] = {0x00, 0x03, 0x02, 0x00, 0x00, 0x29, 0x00, 0x00};
+	static const uint8_t manuf_read[] = {0x04, 0x34, 0x12, 0x04, 0x00, 0x00, 0x00};
+	static const uint8_t cluster_cmd[] = {0x01, 0x05, 0x00, 0x00, 0x00};
+
+	zassert_true(lazy_sampling_is_read_of(read_value, sizeof(read_value),
+					      ZCL_MEASURED_VALUE_ID));
+	zassert_false(lazy_sampling_is_read_of(read_tolerance, sizeof(read_tolerance),
+					       ZCL_MEASURED_VALUE_ID));
+	zassert_false(lazy_sampling_is_read_of(write_value, sizeof(write_value),
+					       ZCL_MEASURED_VALUE_ID));
+	zassert_false(lazy_sampling_is_read_of(manuf_read, sizeof(manuf_read),
+					       ZCL_MEASURED_VALUE_ID));
+	zassert_false(lazy_sampling_is_read_of(cluster_cmd, sizeof(cluster_cmd),
+					       ZCL_MEASURED_VALUE_ID));
+	/* A truncated attribute ID is not a match */
+	zassert_false(lazy_sampling_is_read_of(read_value, sizeof(read_value) - 1,
+					       ZCL_MEASURED_VALUE_ID));
+	zassert_false(lazy_sampling_is_read_of(read_value, 2, ZCL_MEASURED_VALUE_ID));
+}
+
+ZTEST(lazy_sampling, test_fresh_sample_answered_from_cache)
+{
+	struct lazy_sampling_stats before;
+	struct lazy_sampling_stats after;
+	uint32_t fetches;
+
+	zassert_ok(humidity_temperature_svc_trigger_measurement());
+	fetches = fake_sht4x.fetches;
+	lazy_sampling_get_stats(&before);
+
+	zassert_equal(lazy_sampling_on_read(publish), -EALREADY);
+
+	lazy_sampling_get_stats(&after);
+	zassert_equal(after.reads, before.reads + 1);
+	zassert_equal(after.fresh_samples, before.fresh_samples);
+	zassert_equal(fake_sht4x.fetches, fetches, "Sensor sampled for a fresh value");
+	zassert_equal(publishes, 0);
+}
+
+ZTEST(lazy_sampling, test_stale_sample_read_to_response_latency)
+{
+	struct lazy_sampling_stats before;
+	struct lazy_sampling_stats after;
+
+	zassert_ok(humidity_temperature_svc_trigger_measurement());
+	make_sample_stale();
+	lazy_sampling_get_stats(&before);
+
+	zassert_ok(lazy_sampling_on_read(publish));
+
+	lazy_sampling_get_stats(&after);
+	zassert_equal(after.fresh_samples, before.fresh_samples + 1);
+	zassert_equal(publishes, 1);
+	zassert_within(published_temperature, 21.5f, 0.01f);
+	zassert_true(humidity_temperature_svc_get_sample_age_ms() < MAX_AGE_MSEC);
+
+	/* The read waits for one conversion, and not much more */
+	zassert_true(after.last_latency_us >= CONVERSION_MS * USEC_PER_MSEC,
+		     "Latency %u us shorter than the conversion", after.last_latency_us);
+	zassert_true(after.last_latency_us < 2 * CONVERSION_MS * USEC_PER_MSEC,
+		     "Latency %u us", after.last_latency_us);
+	zassert_true(after.max_latency_us >= after.last_latency_us);
+}
+
+static void busy_sample(void *p1, void *p2, void *p3)
+{
+	ARG_UNUSED(p1);
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	(void)humidity_temperature_svc_trigger_measurement();
+}
+
+ZTEST(lazy_sampling, test_read_during_sample_does_not_wait)
+{
+	struct lazy_sampling_stats before;
+	struct lazy_sampling_stats after;
+	int64_t start_ms;
+	int ret;
+
+	make_sample_stale();
+	lazy_sampling_get_stats(&before);
+
+	/* A periodic sample in progress on another thread */
+	fake_sht4x.conversion_ms = 100;
+	k_thread_create(&busy_thread, busy_stack, K_THREAD_STACK_SIZEOF(busy_stack), busy_sample,
+			NULL, NULL, NULL, K_PRIO_PREEMPT(0), 0, K_NO_WAIT);
+	k_sleep(K_MSEC(10));
+
+	start_ms = k_uptime_get();
+	ret = lazy_sampling_on_read(publish);
+	zassert_equal(ret, -EBUSY);
+	zassert_true(k_uptime_get() - start_ms < CONVERSION_MS, "Read blocked on the sensor");
+
+	lazy_sampling_get_stats(&after);
+	zassert_equal(after.busy, before.busy + 1);
+	zassert_equal(after.fresh_samples, before.fresh_samples);
+	zassert_equal(publishes, 0);
+
+	zassert_ok(k_thread_join(&busy_thread, K_SECONDS(1)));
+}
+
+ZTEST(lazy_sampling, test_failed_sample_answered_from_cache)
+{
+	struct lazy_sampling_stats before;
+	struct lazy_sampling_stats after;
+
+	make_sample_stale();
+	lazy_sampling_get_stats(&before);
+
+	fake_sht4x.fetch_error = -EIO;
+	zassert_equal(lazy_sampling_on_read(publish), -EIO);
+
+	lazy_sampling_get_stats(&after);
+	zassert_equal(after.sample_failures, before.sample_failures + 1);
+	zassert_equal(publishes, 0);
+}
+
+ZTEST(lazy_sampling, test_skipped_periods_counted)
+{
+	struct lazy_sampling_stats before;
+	struct lazy_sampling_stats after;
+
+	fake_sht4x.conversion_ms = 0;
+	zassert_ok(humidity_temperature_svc_trigger_measurement());
+	lazy_sampling_get_stats(&before);
+
+	/* 3.5 periods since the last sample, the two full periods in between were skipped */
+	k_sleep(K_MSEC(MEASURING_PERIOD_MSEC * 7 / 2));
+	zassert_ok(humidity_temperature_svc_trigger_measurement());
+	lazy_sampling_get_stats(&after);
+	zassert_equal(after.skipped_samples, before.skipped_samples + 2);
+
+	/* A late sample within the next period skips nothing */
+	k_sleep(K_MSEC(MEASURING_PERIOD_MSEC * 3 / 2));
+	zassert_ok(humidity_temperature_svc_trigger_measurement());
+	lazy_sampling_get_stats(&before);
+	zassert_equal(before.skipped_samples, after.skipped_samples);
+}
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* GPREGRET registers backed by RAM, the test reads and presets them directly */
+
+#ifndef TESTS_HAL_NRF_POWER_STUB_H
+#define TESTS_HAL_NRF_POWER_STUB_H
+
+#include <stdint.h>
+
+#define NRF_POWER NULL
+
+extern uint8_t fake_gpregret[2];
+
+static inline uint8_t nrf_power_gpregret_get(void *p_reg, uint32_t reg_idx)
+{
+	(void)p_reg;
+
+	return fake_gpregret[reg_idx];
+}
+
+static inline void nrf_power_gpregret_set(void *p_reg, uint32_t reg_idx, uint32_t val)
+{
+	(void)p_reg;
+
+	fake_gpregret[reg_idx] = (uint8_t)val;
+}
+
+#endif /* TESTS_HAL_NRF_POWER_STUB_H */
@@ -0,0 +1,14 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Returning sys_poweroff(), the test records the call and keeps running */
+
+#ifndef TESTS_ZEPHYR_SYS_POWEROFF_STUB_H
+#define TESTS_ZEPHYR_SYS_POWEROFF_STUB_H
+
+void sys_poweroff(void);
+
+#endif /* TESTS_ZEPHYR_SYS_POWEROFF_STUB_H */
@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/hwinfo.h>
+#include <zephyr/sys/poweroff.h>
+#include <zephyr/ztest.h>
+
+#include <hal/nrf_power.h>
+
+#include "power_svc.h"
+#include "user_interface.h"
+#include "zigbee_svc.h"
+
+#define STATE_BLOCK_GPREGRET 1
+#define STATE_BLOCK_MAGIC    0xA0
+
+#define RETRY_PERIOD K_SECONDS(CONFIG_UNJOINED_RETRY_PERIOD_SECONDS)
+#define HALF_PERIOD  K_MSEC(CONFIG_UNJOINED_RETRY_PERIOD_SECONDS * MSEC_PER_SEC / 2)
+/* Past the end of the retry period, without reaching the end of the next one */
+#define PAST_PERIOD  K_MSEC(CONFIG_UNJOINED_RETRY_PERIOD_SECONDS * MSEC_PER_SEC + 100)
+
+uint8_t fake_gpregret[2];
+
+static uint32_t fake_reset_cause;
+static int reset_cause_clears;
+static int join_calls;
+static int button_wakeups;
+static int led_offs;
+static K_SEM_DEFINE(poweroff_sem, 0, 1);
+
+int z_impl_hwinfo_get_reset_cause(uint32_t *cause)
+{
+	*cause = fake_reset_cause;
+
+	return 0;
+}
+
+int z_impl_hwinfo_clear_reset_cause(void)
+{
+	fake_reset_cause = 0;
+	reset_cause_clears++;
+
+	return 0;
+}
+
+int ui_enable_button_wakeup(void)
+{
+	button_wakeups++;
+
+	return 0;
+}
+
+int ui_set_status_led_off(void)
+{
+	led_offs++;
+
+	return 0;
+}
+
+int zigbee_svc_schedule_fn(enum zigbee_function fn_id, uint16_t user_param)
+{
+	ARG_UNUSED(user_param);
+
+	if (fn_id == ZIGBEE_START_JOINING) {
+		join_calls++;
+	}
+
+	return 0;
+}
+
+/* Declared returning by the stub header, the system workqueue goes on with the next test */
+void sys_poweroff(void)
+{
+	k_sem_give(&poweroff_sem);
+}
+
+struct power_svc_fixture {
+	enum power_state initial_state;
+};
+
+static void *power_svc_setup(void)
+{
+	static struct power_svc_fixture fixture;
+
+	fixture.initial_state = power_svc_get_state();
+
+	return &fixture;
+}
+
+static void power_svc_before(void *f)
+{
+	ARG_UNUSED(f);
+
+	/* Joining cancels the retry timer and clears the retry counter */
+	power_svc_network_joined();
+
+	memset(fake_gpregret, 0, sizeof(fake_gpregret));
+	fake_reset_cause = 0;
+	reset_cause_clears = 0;
+	join_calls = 0;
+	button_wakeups = 0;
+	led_offs = 0;
+	k_sem_reset(&poweroff_sem);
+}
+
+ZTEST_SUITE(power_svc, NULL, power_svc_setup, power_svc_before, NULL, NULL);
+
+ZTEST_F(power_svc, test_commissioning_on_boot)
+{
+	zassert_equal(fixture->initial_state, POWER_STATE_COMMISSIONING);
+}
+
+ZTEST(power_svc, test_estimated_current_order)
+{
+	zassert_true(power_svc_estimated_current_na(POWER_STATE_OFF) <
+		     power_svc_estimated_current_na(POWER_STATE_RETRY_WAIT));
+	zassert_true(power_svc_estimated_current_na(POWER_STATE_RETRY_WAIT) <
+		     power_svc_estimated_current_na(POWER_STATE_JOINED));
+	zassert_true(power_svc_estimated_current_na(POWER_STATE_JOINED) <
+		     power_svc_estimated_current_na(POWER_STATE_COMMISSIONING));
+}
+
+ZTEST(power_svc, test_joined_cancels_retry)
+{
+	power_svc_network_not_joined();
+	zassert_equal(power_svc_get_state(), POWER_STATE_RETRY_WAIT);
+
+	power_svc_network_joined();
+	zassert_equal(power_svc_get_state(), POWER_STATE_JOINED);
+
+	k_sleep(PAST_PERIOD);
+	zassert_equal(join_calls, 0);
+	zassert_equal(power_svc_get_state(), POWER_STATE_JOINED);
+}
+
+ZTEST(power_svc, test_joined_resets_retries)
+{
+	/* One retry short of System OFF, then joined */
+	for (int i = 0; i < CONFIG_UNJOINED_RETRY_COUNT; i++) {
+		power_svc_network_not_joined();
+		k_sleep(PAST_PERIOD);
+	}
+	zassert_equal(join_calls, CONFIG_UNJOINED_RETRY_COUNT);
+
+	power_svc_network_joined();
+
+	/* A full set of retries is available again */
+	power_svc_network_not_joined();
+	k_sleep(PAST_PERIOD);
+	zassert_equal(join_calls, CONFIG_UNJOINED_RETRY_COUNT + 1);
+	zassert_equal(power_svc_get_state(), POWER_STATE_COMMISSIONING);
+	zassert_equal(k_sem_take(&poweroff_sem, K_NO_WAIT), -EBUSY);
+}
+
+ZTEST(power_svc, test_not_joined_restarts_timer)
+{
+	power_svc_network_not_joined();
+	k_sleep(HALF_PERIOD);
+
+	/* Every failure reported by the stack restarts the retry period */
+	power_svc_network_not_joined();
+	k_sleep(HALF_PERIOD);
+	zassert_equal(join_calls, 0);
+	zassert_equal(power_svc_get_state(), POWER_STATE_RETRY_WAIT);
+
+	k_sleep(HALF_PERIOD);
+	k_sleep(K_MSEC(100));
+	zassert_equal(join_calls, 1);
+}
+
+ZTEST(power_svc, test_not_joined_retries_commissioning)
+{
+	power_svc_network_not_joined();
+	zassert_equal(power_svc_get_state(), POWER_STATE_RETRY_WAIT);
+
+	k_sleep(K_MSEC(CONFIG_UNJOINED_RETRY_PERIOD_SECONDS * MSEC_PER_SEC - 100));
+	zassert_equal(join_calls, 0, "Commissioning restarted before the retry period");
+
+	k_sleep(K_MSEC(200));
+	zassert_equal(join_calls, 1);
+	zassert_equal(power_svc_get_state(), POWER_STATE_COMMISSIONING);
+}
+
+ZTEST(power_svc, test_restore_after_system_off)
+{
+	fake_gpregret[STATE_BLOCK_GPREGRET] = STATE_BLOCK_MAGIC | 2;
+	fake_reset_cause = RESET_LOW_POWER_WAKE;
+
+	power_svc_init();
+
+	zassert_equal(fake_gpregret[STATE_BLOCK_GPREGRET], 0, "State block not cleared");
+	zassert_equal(reset_cause_clears, 1);
+	zassert_equal(power_svc_get_state(), POWER_STATE_JOINED, "Init must not change the state");
+
+	/* A cold boot without a state block is left alone as well */
+	power_svc_init();
+	zassert_equal(fake_gpregret[STATE_BLOCK_GPREGRET], 0);
+}
+
+ZTEST(power_svc, test_system_off_after_retries)
+{
+	for (int i = 0; i < CONFIG_UNJOINED_RETRY_COUNT; i++) {
+		power_svc_network_not_joined();
+		k_sleep(PAST_PERIOD);
+		zassert_equal(power_svc_get_state(), POWER_STATE_COMMISSIONING);
+	}
+
+	power_svc_network_not_joined();
+	zassert_ok(k_sem_take(&poweroff_sem, K_SECONDS(CONFIG_UNJOINED_RETRY_PERIOD_SECONDS * 2)),
+		   "System OFF not entered");
+
+	zassert_equal(join_calls, CONFIG_UNJOINED_RETRY_COUNT);
+	zassert_equal(power_svc_get_state(), POWER_STATE_OFF);
+	zassert_equal(button_wakeups, 1);
+	zassert_equal(led_offs, 1);
+	zassert_equal(fake_gpregret[STATE_BLOCK_GPREGRET],
+		      STATE_BLOCK_MAGIC | CONFIG_UNJOINED_RETRY_COUNT);
+
+	/* Nothing is left scheduled once System OFF was requested */
+	k_sleep(PAST_PERIOD);
+	zassert_equal(join_calls, CONFIG_UNJOINED_RETRY_COUNT);
+	zassert_equal(k_sem_take(&poweroff_sem, K_NO_WAIT), -EBUSY);
+}
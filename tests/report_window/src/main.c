@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#include "report_window.h"
+
+#define MEASURING_PERIOD_MSEC (1000 * CONFIG_MEASURING_PERIOD_SECONDS)
+
+#define TEMPERATURE 0
+#define HUMIDITY    1
+#define ATTR_COUNT  2
+
+/* Periodic reports every 5 measurements, the temperature changes every other measurement */
+#define MAX_INTERVAL_S  (5 * CONFIG_MEASURING_PERIOD_SECONDS)
+#define CHANGE_EVERY    2
+#define SESSION_MEASURE 60
+#define SESSION_MS      (SESSION_MEASURE * MEASURING_PERIOD_MSEC)
+#define STEP_MS         1000
+
+/* The reporting engine of the stack as far as the windows see it */
+struct engine {
+	struct report_window_attr attrs[ATTR_COUNT];
+	/* Start of the maximum interval of each attribute */
+	int64_t last_sent_ms[ATTR_COUNT];
+};
+
+static struct engine engine;
+static int64_t now_ms;
+
+static void engine_update(bool coalesce)
+{
+	uint32_t forced = report_window_update(engine.attrs, ATTR_COUNT, now_ms, coalesce);
+
+	/* The caller marks the forced attributes for reporting */
+	for (size_t i = 0; i < ATTR_COUNT; i++) {
+		if (forced & BIT(i)) {
+			engine.attrs[i].flagged = true;
+		}
+	}
+}
+
+/* The engine sends every flagged report and restarts the maximum interval */
+static void engine_send(void)
+{
+	for (size_t i = 0; i < ATTR_COUNT; i++) {
+		if (engine.attrs[i].flagged) {
+			engine.attrs[i].flagged = false;
+			engine.last_sent_ms[i] = now_ms;
+		}
+	}
+
+	(void)report_window_check(engine.attrs, ATTR_COUNT, now_ms);
+	zassert_false(report_window_is_open());
+}
+
+/* Periodic reports the engine sends on its own, each one wakes the radio */
+static void engine_periodic(bool coalesce)
+{
+	for (size_t i = 0; i < ATTR_COUNT; i++) {
+		if (now_ms >= engine.last_sent_ms[i] + MAX_INTERVAL_S * MSEC_PER_SEC) {
+			engine.attrs[i].flagged = true;
+			engine_update(coalesce);
+			engine_send();
+		}
+	}
+}
+
+static void measure(uint32_t n, bool coalesce)
+{
+	if (n % CHANGE_EVERY == 0) {
+		engine.attrs[TEMPERATURE].flagged = true;
+	}
+
+	if (coalesce) {
+		engine_update(true);
+	} else {
+		/* One callback per attribute */
+		engine_update(false);
+		engine_update(false);
+	}
+
+	engine_send();
+}
+
+/* Runs the session and returns the window counters it added */
+static void run_session(bool coalesce, struct report_window_stats *added)
+{
+	struct report_window_stats before;
+	struct report_window_stats after;
+	int64_t start_ms = now_ms;
+
+	report_window_get_stats(&before);
+
+	for (size_t i = 0; i < ATTR_COUNT; i++) {
+		engine.last_sent_ms[i] = now_ms;
+	}
+
+	for (; now_ms < start_ms + SESSION_MS; now_ms += STEP_MS) {
+		if ((now_ms - start_ms) % MEASURING_PERIOD_MSEC == 0) {
+			measure((now_ms - start_ms) / MEASURING_PERIOD_MSEC, coalesce);
+		}
+		engine_periodic(coalesce);
+	}
+
+	report_window_get_stats(&after);
+	added->radio_windows = after.radio_windows - before.radio_windows;
+	added->reports = after.reports - before.reports;
+	added->forced = after.forced - before.forced;
+}
+
+static void report_window_before(void *f)
+{
+	ARG_UNUSED(f);
+
+	report_window_reset();
+	memset(&engine, 0, sizeof(engine));
+	for (size_t i = 0; i < ATTR_COUNT; i++) {
+		engine.attrs[i].configured = true;
+		engine.attrs[i].max_interval_s = MAX_INTERVAL_S;
+	}
+
+	/* Every test starts on a new time line */
+	now_ms += 100 * SESSION_MS;
+}
+
+ZTEST_SUITE(report_window, NULL, NULL, report_window_before, NULL, NULL);
+
+ZTEST(report_window, test_nothing_due)
+{
+	struct report_window_stats before;
+	struct report_window_stats after;
+
+	report_window_get_stats(&before);
+	zassert_equal(report_window_update(engine.attrs, ATTR_COUNT, now_ms, true), 0);
+	report_window_get_stats(&after);
+
+	zassert_false(report_window_is_open());
+	zassert_equal(after.radio_windows, before.radio_windows);
+	zassert_false(report_window_check(engine.attrs, ATTR_COUNT, now_ms));
+}
+
+ZTEST(report_window, test_due_reports_share_window)
+{
+	struct report_window_stats before;
+	struct report_window_stats after;
+
+	report_window_get_stats(&before);
+	engine.attrs[TEMPERATURE].flagged = true;
+	engine_update(false);
+	engine.attrs[HUMIDITY].flagged = true;
+	engine_update(false);
+
+	/* Open until the last report has left */
+	engine.attrs[TEMPERATURE].flagged = false;
+	zassert_false(report_window_check(engine.attrs, ATTR_COUNT, now_ms));
+	zassert_true(report_window_is_open());
+	engine.attrs[HUMIDITY].flagged = false;
+	zassert_true(report_window_check(engine.attrs, ATTR_COUNT, now_ms));
+
+	report_window_get_stats(&after);
+	zassert_equal(after.radio_windows, before.radio_windows + 1);
+	zassert_equal(after.reports, before.reports + 2);
+	zassert_equal(after.forced, before.forced);
+}
+
+ZTEST(report_window, test_removed_rule_closes_window)
+{
+	engine.attrs[HUMIDITY].flagged = true;
+	engine_update(true);
+
+	engine.attrs[HUMIDITY].configured = false;
+	zassert_true(report_window_check(engine.attrs, ATTR_COUNT, now_ms));
+}
+
+ZTEST(report_window, test_periodic_report_forced_before_expiry)
+{
+	/* Humidity was last reported almost a maximum interval ago */
+	engine.attrs[HUMIDITY].flagged = true;
+	engine_update(true);
+	engine_send();
+	now_ms += MAX_INTERVAL_S * MSEC_PER_SEC - MEASURING_PERIOD_MSEC / 2;
+
+	/* Nothing due, nothing forced */
+	zassert_equal(report_window_update(engine.attrs, ATTR_COUNT, now_ms, true), 0);
+
+	/* A temperature report takes the humidity report along */
+	engine.attrs[TEMPERATURE].flagged = true;
+	zassert_equal(report_window_update(engine.attrs, ATTR_COUNT, now_ms, true), BIT(HUMIDITY));
+
+	/* Not without coalescing */
+	report_window_reset();
+	engine.attrs[HUMIDITY].flagged = true;
+	engine_update(false);
+	engine_send();
+	now_ms += MAX_INTERVAL_S * MSEC_PER_SEC - MEASURING_PERIOD_MSEC / 2;
+	engine.attrs[TEMPERATURE].flagged = true;
+	zassert_equal(report_window_update(engine.attrs, ATTR_COUNT, now_ms, false), 0);
+}
+
+ZTEST(report_window, test_report_time_unknown_not_forced)
+{
+	engine.attrs[TEMPERATURE].flagged = true;
+	zassert_equal(report_window_update(engine.attrs, ATTR_COUNT, now_ms, true), 0);
+}
+
+ZTEST(report_window, test_fewer_windows_coalesced)
+{
+	struct report_window_stats separate;
+	struct report_window_stats coalesced;
+
+	run_session(false, &separate);
+	report_window_reset();
+	run_session(true, &coalesced);
+
+	TC_PRINT("%u measurements: %u windows separate, %u windows coalesced (%u forced)\n",
+		 SESSION_MEASURE, separate.radio_windows, coalesced.radio_windows,
+		 coalesced.forced);
+
+	/*
+	 * Every temperature change takes a window and the periodic humidity reports join them,
+	 * except the first one. Its time is not known before it was seen to leave.
+	 */
+	zassert_equal(coalesced.radio_windows, SESSION_MEASURE / CHANGE_EVERY + 1);
+	zassert_true(coalesced.forced > 0);
+	zassert_true(coalesced.radio_windows < separate.radio_windows);
+}
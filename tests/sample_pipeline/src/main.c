@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#include "sample_pipeline.h"
+
+#define PERIOD_MS  CONFIG_SAMPLE_PIPELINE_PERIOD_MS
+#define DECIMATION CONFIG_SAMPLE_PIPELINE_DECIMATION
+#define RING_SIZE  CONFIG_SAMPLE_PIPELINE_RING_SIZE
+
+#define THROUGHPUT_MS 1000
+
+/* The source always delivers the same values, so every mean equals them */
+#define SAMPLE_TEMPERATURE 2150
+#define SAMPLE_HUMIDITY    4525
+
+static int source_error;
+static uint32_t source_calls;
+
+static uint32_t outputs;
+static int16_t output_temperature;
+static uint16_t output_humidity;
+static uint32_t output_latency_us;
+
+static int source(int16_t *temperature, uint16_t *humidity)
+{
+	source_calls++;
+	if (source_error != 0) {
+		return source_error;
+	}
+
+	*temperature = SAMPLE_TEMPERATURE;
+	*humidity = SAMPLE_HUMIDITY;
+
+	return 0;
+}
+
+static void output(int16_t temperature, uint16_t humidity, uint32_t sampled_cyc)
+{
+	output_temperature = temperature;
+	output_humidity = humidity;
+	output_latency_us = k_cyc_to_us_floor32(k_cycle_get_32() - sampled_cyc);
+	outputs++;
+}
+
+static void *sample_pipeline_setup(void)
+{
+	sample_pipeline_init(source, output);
+
+	return NULL;
+}
+
+static void sample_pipeline_before(void *f)
+{
+	ARG_UNUSED(f);
+
+	source_error = 0;
+}
+
+ZTEST_SUITE(sample_pipeline, NULL, sample_pipeline_setup, sample_pipeline_before, NULL, NULL);
+
+ZTEST(sample_pipeline, test_full_ring_drops_samples)
+{
+	struct sample_pipeline_stats before;
+	struct sample_pipeline_stats after;
+	int full = 0;
+
+	/* Neither the sampling thread nor the drain work run until the ring overflowed */
+	k_sched_lock();
+	sample_pipeline_get_stats(&before);
+	for (int i = 0; i < RING_SIZE + 3; i++) {
+		if (sample_pipeline_push(SAMPLE_TEMPERATURE, SAMPLE_HUMIDITY) == -ENOBUFS) {
+			full++;
+		}
+	}
+	sample_pipeline_get_stats(&after);
+	k_sched_unlock();
+
+	zassert_true(full >= 3);
+	zassert_equal(after.dropped, before.dropped + full);
+	zassert_equal(after.samples, before.samples + RING_SIZE + 3 - full);
+
+	/* Drained once the workqueue runs again */
+	k_sleep(K_MSEC(1));
+	zassert_equal(sample_pipeline_push(SAMPLE_TEMPERATURE, SAMPLE_HUMIDITY), 0);
+}
+
+ZTEST(sample_pipeline, test_output_is_window_mean)
+{
+	uint32_t start = outputs;
+
+	k_sleep(K_MSEC(PERIOD_MS * DECIMATION * 2));
+
+	zassert_true(outputs > start);
+	zassert_equal(output_temperature, SAMPLE_TEMPERATURE);
+	zassert_equal(output_humidity, SAMPLE_HUMIDITY);
+}
+
+ZTEST(sample_pipeline, test_source_errors_counted)
+{
+	struct sample_pipeline_stats before;
+	struct sample_pipeline_stats after;
+
+	sample_pipeline_get_stats(&before);
+	source_error = -EIO;
+	k_sleep(K_MSEC(PERIOD_MS * 10));
+	source_error = 0;
+	sample_pipeline_get_stats(&after);
+
+	zassert_true(after.source_errors - before.source_errors >= 9);
+	zassert_equal(after.samples, before.samples, "Failed samples pushed");
+}
+
+ZTEST(sample_pipeline, test_sustained_throughput)
+{
+	struct sample_pipeline_stats before;
+	struct sample_pipeline_stats after;
+	uint32_t calls = source_calls;
+
+	sample_pipeline_get_stats(&before);
+	k_sleep(K_MSEC(THROUGHPUT_MS));
+	sample_pipeline_get_stats(&after);
+
+	/* Absolute deadlines, one sample per period without drift */
+	zassert_within(source_calls - calls, THROUGHPUT_MS / PERIOD_MS, 1);
+	zassert_within(after.samples - before.samples, THROUGHPUT_MS / PERIOD_MS, 1);
+	zassert_equal(after.dropped, before.dropped, "Drain did not keep up");
+	zassert_within(after.outputs - before.outputs, THROUGHPUT_MS / PERIOD_MS / DECIMATION, 1);
+
+	/* Every window reaches the output long before the next sample */
+	zassert_true(after.last_latency_us < PERIOD_MS * USEC_PER_MSEC);
+	zassert_true(output_latency_us < PERIOD_MS * USEC_PER_MSEC);
+}